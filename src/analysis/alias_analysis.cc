@@ -0,0 +1,234 @@
+#include "alias_analysis.hh"
+#include "constant.hh"
+#include "function.hh"
+#include "global_variable.hh"
+#include "instruction.hh"
+#include "type.hh"
+#include "utils.hh"
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+using namespace pass;
+using namespace ir;
+using namespace std;
+
+namespace {
+
+// the index as an affine expression, looking through add/sub and mul/shl by
+// constants, depth limits the cost on long chains
+LinearExpr linear_index(Value *v, unsigned depth = 8) {
+    if (depth == 0 or not v->is<IBinaryInst>())
+        return LinearExpr::of(v);
+    auto inst = v->as<IBinaryInst>();
+    auto lhs = inst->lhs(), rhs = inst->rhs();
+    switch (inst->get_ibin_op()) {
+    case IBinaryInst::ADD:
+        return linear_index(lhs, depth - 1) + linear_index(rhs, depth - 1);
+    case IBinaryInst::SUB:
+        return linear_index(lhs, depth - 1) - linear_index(rhs, depth - 1);
+    case IBinaryInst::MUL:
+        if (rhs->is<ConstInt>())
+            return linear_index(lhs, depth - 1) * rhs->as<ConstInt>()->val();
+        if (lhs->is<ConstInt>())
+            return linear_index(rhs, depth - 1) * lhs->as<ConstInt>()->val();
+        break;
+    case IBinaryInst::SHL:
+        if (rhs->is<ConstInt>() and rhs->as<ConstInt>()->val() >= 0 and
+            rhs->as<ConstInt>()->val() < 31)
+            return linear_index(lhs, depth - 1) *
+                   (1 << rhs->as<ConstInt>()->val());
+        break;
+    default:
+        break;
+    }
+    return LinearExpr::of(v);
+}
+
+// how many int/float elements a value of the type takes
+int elem_cnt(Type *type) {
+    if (type->is<ArrayType>())
+        return type->as<ArrayType>()->get_total_cnt();
+    return 1;
+}
+
+// allocas and globals are distinct objects, while arguments may point to
+// anything but the allocas of the current function
+bool is_identified_object(Value *base) {
+    return base->is<AllocaInst>() or base->is<GlobalVariable>();
+}
+
+} // namespace
+
+bool AliasAnalysis::run(PassManager *mgr) {
+    clear();
+    _result._func_info = &mgr->get_result<FuncInfo>();
+    return false;
+}
+
+using ResultType = AliasAnalysis::ResultType;
+
+MemLoc ResultType::location(Value *ptr) {
+    auto elem_type = ptr->get_type()->as<PointerType>()->get_elem_type();
+    MemLoc loc{ptr, ptr, {0}, elem_cnt(elem_type)};
+    while (loc.base->is<GetElementPtrInst>()) {
+        auto gep = loc.base->as<GetElementPtrInst>();
+        loc.base = gep->base_ptr();
+        auto type = loc.base->get_type()->as<PointerType>()->get_elem_type();
+        for (unsigned i = 1; i < gep->operands().size(); ++i) {
+            loc.offset =
+                loc.offset + linear_index(gep->get_operand(i)) * elem_cnt(type);
+            if (type->is<ArrayType>())
+                type = type->as<ArrayType>()->get_elem_type();
+        }
+    }
+    return loc;
+}
+
+bool ResultType::may_share_object(Value *lhs, Value *rhs) const {
+    if (lhs == rhs)
+        return true;
+    if (is_identified_object(lhs) and is_identified_object(rhs))
+        return false;
+    if ((lhs->is<AllocaInst>() and rhs->is<Argument>()) or
+        (lhs->is<Argument>() and rhs->is<AllocaInst>()))
+        return false;
+    return true;
+}
+
+AliasResult ResultType::alias(Value *lhs, Value *rhs) const {
+    if (lhs == rhs)
+        return AliasResult::MustAlias;
+    return alias(location(lhs), location(rhs));
+}
+
+AliasResult ResultType::alias(const MemLoc &lhs, const MemLoc &rhs) const {
+    if (lhs.ptr == rhs.ptr)
+        return AliasResult::MustAlias;
+    if (lhs.base != rhs.base) {
+        return may_share_object(lhs.base, rhs.base) ? AliasResult::MayAlias
+                                                    : AliasResult::NoAlias;
+    }
+    auto diff = lhs.offset - rhs.offset;
+    vector<int> coefs;
+    for (auto [_, k] : diff.terms)
+        coefs.push_back(k);
+    return compare_offsets(lhs, rhs, diff.constant, coefs);
+}
+
+AliasResult ResultType::alias_at_any_time(const MemLoc &lhs,
+                                          const MemLoc &rhs) const {
+    if (lhs.base != rhs.base) {
+        return may_share_object(lhs.base, rhs.base) ? AliasResult::MayAlias
+                                                    : AliasResult::NoAlias;
+    }
+    // only the values defined once for all, i.e. the arguments, cancel out
+    auto diff = LinearExpr{lhs.offset.constant - rhs.offset.constant};
+    vector<int> coefs;
+    for (auto [v, k] : lhs.offset.terms) {
+        if (v->is<Argument>())
+            diff = diff + LinearExpr::of(v) * k;
+        else
+            coefs.push_back(k);
+    }
+    for (auto [v, k] : rhs.offset.terms) {
+        if (v->is<Argument>())
+            diff = diff - LinearExpr::of(v) * k;
+        else
+            coefs.push_back(-k);
+    }
+    for (auto [_, k] : diff.terms)
+        coefs.push_back(k);
+    return compare_offsets(lhs, rhs, diff.constant, coefs);
+}
+
+// lhs.offset - rhs.offset = c + k1 * v1 + ..., where coefs are k1, ...
+AliasResult ResultType::compare_offsets(const MemLoc &lhs, const MemLoc &rhs,
+                                        int c, const vector<int> &coefs) {
+    if (not coefs.empty()) {
+        // never 0 if gcd(k1, ...) does not divide c
+        if (lhs.size != 1 or rhs.size != 1)
+            return AliasResult::MayAlias;
+        int64_t g = 0;
+        for (auto k : coefs)
+            g = gcd(g, llabs(static_cast<int64_t>(k)));
+        if (g > 1 and c % g != 0)
+            return AliasResult::NoAlias;
+        return AliasResult::MayAlias;
+    }
+    // lhs starts d elements after rhs
+    auto d = static_cast<int64_t>(c);
+    if (d >= rhs.size or -d >= lhs.size)
+        return AliasResult::NoAlias;
+    if (d == 0 and lhs.size == rhs.size)
+        return AliasResult::MustAlias;
+    return AliasResult::MayAlias;
+}
+
+ModRefInfo ResultType::get_mod_ref(Instruction *inst, Value *ptr) const {
+    return get_mod_ref(inst, location(ptr));
+}
+
+ModRefInfo ResultType::get_mod_ref(Instruction *inst,
+                                   const MemLoc &loc) const {
+    if (inst->is<LoadInst>()) {
+        if (alias(location(inst->as<LoadInst>()->ptr()), loc) ==
+            AliasResult::NoAlias)
+            return ModRefInfo::NoModRef;
+        return ModRefInfo::Ref;
+    }
+    if (inst->is<StoreInst>()) {
+        if (alias(location(inst->as<StoreInst>()->ptr()), loc) ==
+            AliasResult::NoAlias)
+            return ModRefInfo::NoModRef;
+        return ModRefInfo::Mod;
+    }
+    if (inst->is<CallInst>())
+        return call_mod_ref(inst->as<CallInst>(), loc);
+    return ModRefInfo::NoModRef;
+}
+
+/* by the summary of the callee
+ *
+ * the callee reaches the allocas of the caller only through the pointers
+ * passed to it, and the globals either by itself or through the pointers. an
+ * argument of the caller may point to any global
+ */
+ModRefInfo ResultType::call_mod_ref(CallInst *call, const MemLoc &loc) const {
+    auto callee = call->get_operand(0)->as<Function>();
+    if (_func_info->is_pure_function(callee))
+        return ModRefInfo::NoModRef;
+    auto &summary = _func_info->summary(callee);
+    bool ref = summary.ref_unknown, mod = summary.mod_unknown;
+    for (unsigned i = 1; i < call->operands().size(); ++i) {
+        auto arg = call->get_operand(i);
+        if (not arg->get_type()->is<PointerType>())
+            continue;
+        if (not may_share_object(location(arg).base, loc.base))
+            continue;
+        ref |= contains(summary.ref_args, i - 1);
+        mod |= contains(summary.mod_args, i - 1);
+    }
+    if (loc.base->is<GlobalVariable>()) {
+        auto global = loc.base->as<GlobalVariable>();
+        ref |= contains(summary.ref_globals, global);
+        mod |= contains(summary.mod_globals, global);
+    } else if (not loc.base->is<AllocaInst>()) {
+        ref |= not summary.ref_globals.empty();
+        mod |= not summary.mod_globals.empty();
+    }
+    if (ref and mod)
+        return ModRefInfo::ModRef;
+    if (mod)
+        return ModRefInfo::Mod;
+    return ref ? ModRefInfo::Ref : ModRefInfo::NoModRef;
+}
+
+bool ResultType::is_dereferenceable(const MemLoc &loc) const {
+    if (not is_identified_object(loc.base) or not loc.offset.is_const())
+        return false;
+    auto type = loc.base->get_type()->as<PointerType>()->get_elem_type();
+    auto off = loc.offset.constant;
+    return off >= 0 and off + loc.size <= elem_cnt(type);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "func_info.hh"
+#include "instruction.hh"
+#include "pass.hh"
+#include "scalar_evolution.hh"
+#include "value.hh"
+#include <cstdint>
+#include <vector>
+
+namespace pass {
+
+enum class AliasResult : uint8_t {
+    NoAlias = 0,
+    MayAlias,
+    MustAlias,
+};
+
+enum class ModRefInfo : uint8_t {
+    NoModRef = 0,
+    Ref = 1,
+    Mod = 2,
+    ModRef = Ref | Mod,
+};
+
+inline bool is_mod(ModRefInfo mr) {
+    return static_cast<uint8_t>(mr) & static_cast<uint8_t>(ModRefInfo::Mod);
+}
+inline bool is_ref(ModRefInfo mr) {
+    return static_cast<uint8_t>(mr) & static_cast<uint8_t>(ModRefInfo::Ref);
+}
+
+/* the elements [offset, offset + size) of the object at base, counted in
+ * int/float elements, e.g. for int a[2][4], a[i][j + 1] is
+ * {a, 4 * i + j + 1, 1} and a[1] is {a, 4, 4}
+ */
+struct MemLoc {
+    ir::Value *ptr{nullptr};
+    ir::Value *base{nullptr};
+    LinearExpr offset;
+    int size{1};
+};
+
+/* alias analysis of the pointers in one function
+ *
+ * the base of a pointer is found by walking the gep chain, and the indices are
+ * folded into an affine offset. two pointers to the same base are compared by
+ * their offsets, while distinct allocas and globals never alias, neither does
+ * an alloca and an argument, as a local array never escapes to the caller
+ *
+ * the results are computed on query, so they never go out of date
+ */
+class AliasAnalysis final : public AnalysisPass {
+  public:
+    class ResultType {
+        friend class AliasAnalysis;
+
+      public:
+        static MemLoc location(ir::Value *ptr);
+
+        // the same value in the two locations is taken to be the same number,
+        // which holds if it is not redefined between the two accesses, e.g.
+        // they are not in different iterations of a loop it is defined in
+        AliasResult alias(ir::Value *lhs, ir::Value *rhs) const;
+        AliasResult alias(const MemLoc &lhs, const MemLoc &rhs) const;
+        // for two accesses at any time in the function, only the arguments
+        // are known to hold the same number
+        AliasResult alias_at_any_time(const MemLoc &lhs,
+                                      const MemLoc &rhs) const;
+
+        // whether inst may write or read the memory at ptr
+        ModRefInfo get_mod_ref(ir::Instruction *inst, ir::Value *ptr) const;
+        ModRefInfo get_mod_ref(ir::Instruction *inst, const MemLoc &loc) const;
+
+        // whether the location is inside its object for sure, so that a load
+        // from it can be executed speculatively
+        bool is_dereferenceable(const MemLoc &loc) const;
+
+      private:
+        const FuncInfo::ResultType *_func_info{nullptr};
+
+        // whether the objects at the two bases may be the same one
+        bool may_share_object(ir::Value *lhs, ir::Value *rhs) const;
+        static AliasResult compare_offsets(const MemLoc &lhs,
+                                           const MemLoc &rhs, int c,
+                                           const std::vector<int> &coefs);
+        ModRefInfo call_mod_ref(ir::CallInst *call, const MemLoc &loc) const;
+    };
+
+    void get_analysis_usage(AnalysisUsage &AU) const final {
+        using KillType = AnalysisUsage::KillType;
+        AU.set_kill_type(KillType::None);
+        AU.add_require<FuncInfo>();
+    }
+
+    std::any get_result() const final { return &_result; }
+
+    bool run(PassManager *mgr) final;
+
+    void clear() final { _result._func_info = nullptr; }
+
+  private:
+    ResultType _result;
+};
+
+} // namespace pass
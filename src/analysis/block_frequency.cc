@@ -0,0 +1,232 @@
+#include "block_frequency.hh"
+#include "constant.hh"
+#include "instruction.hh"
+#include "utils.hh"
+#include <algorithm>
+
+using namespace pass;
+using namespace ir;
+using namespace std;
+
+namespace {
+
+// the probability of the likely side, see Ball and Larus, Branch Prediction
+// for Free
+constexpr double loop_branch_prob = 0.88;
+constexpr double loop_exit_prob = 0.80;
+constexpr double return_prob = 0.72;
+constexpr double call_prob = 0.78;
+constexpr double opcode_prob = 0.84;
+// a loop runs at most 1024 times on the average
+constexpr double max_cyclic_prob = 1 - 1.0 / 1024;
+
+// the bb returns at once, also through a bb with nothing but phis and ret
+bool is_returning(BasicBlock *bb) {
+    auto term = &bb->insts().back();
+    if (term->is<RetInst>())
+        return true;
+    if (bb->suc_bbs().size() != 1 or term->operands().size() != 1)
+        return false;
+    auto next = *bb->suc_bbs().begin();
+    return all_of(next->insts().begin(), next->insts().end(), [](auto &inst) {
+        return inst.template is<PhiInst>() or inst.template is<RetInst>();
+    });
+}
+
+bool has_call(BasicBlock *bb) {
+    return any_of(bb->insts().begin(), bb->insts().end(),
+                  [](auto &inst) { return inst.template is<CallInst>(); });
+}
+
+} // namespace
+
+bool BlockFrequency::run(PassManager *mgr) {
+    clear();
+    auto &dom = mgr->get_result<Dominator>();
+    for (auto &f_r : mgr->get_module()->functions()) {
+        if (f_r.is_external)
+            continue;
+        _result.freqs[&f_r].build(dom.at(&f_r));
+    }
+    return false;
+}
+
+void FreqInfo::build(const DomTree &dom) {
+    _rpo.clear();
+    _loops.clear();
+    _inner_header.clear();
+    _depth.clear();
+    _prob.clear();
+    _freq.clear();
+    _cyclic_prob.clear();
+
+    // post order by an iterative dfs
+    set<BasicBlock *> visited{dom.root()};
+    vector<pair<BasicBlock *, set<BasicBlock *>::const_iterator>> stack{
+        {dom.root(), dom.root()->suc_bbs().begin()}};
+    while (not stack.empty()) {
+        auto &[bb, it] = stack.back();
+        if (it == bb->suc_bbs().end()) {
+            _rpo.push_back(bb);
+            stack.pop_back();
+            continue;
+        }
+        auto suc = *it++;
+        if (visited.insert(suc).second)
+            stack.push_back({suc, suc->suc_bbs().begin()});
+    }
+    reverse(_rpo.begin(), _rpo.end());
+
+    find_loops(dom);
+    compute_probs();
+
+    // inner loops are smaller than the loops containing them
+    vector<BasicBlock *> headers;
+    for (auto &[header, _] : _loops)
+        headers.push_back(header);
+    sort(headers.begin(), headers.end(), [&](auto a, auto b) {
+        auto sa = _loops.at(a).size(), sb = _loops.at(b).size();
+        return sa != sb ? sa < sb : dom.number(a) < dom.number(b);
+    });
+    for (auto header : headers)
+        propagate(header, &_loops.at(header));
+    propagate(dom.root(), nullptr);
+}
+
+// a loop is made of the bbs reaching a latch without going through the
+// header, the natural loops with the same header are merged
+void FreqInfo::find_loops(const DomTree &dom) {
+    for (auto header : _rpo) {
+        vector<BasicBlock *> work;
+        for (auto pre : header->pre_bbs()) {
+            if (dom.contains(pre) and dom.dominates(header, pre))
+                work.push_back(pre);
+        }
+        if (work.empty())
+            continue;
+        auto &bbs = _loops[header];
+        bbs.insert(header);
+        while (not work.empty()) {
+            auto bb = work.back();
+            work.pop_back();
+            if (not bbs.insert(bb).second)
+                continue;
+            for (auto pre : bb->pre_bbs()) {
+                if (dom.contains(pre))
+                    work.push_back(pre);
+            }
+        }
+    }
+    for (auto &[header, bbs] : _loops) {
+        for (auto bb : bbs) {
+            ++_depth[bb];
+            auto it = _inner_header.find(bb);
+            if (it == _inner_header.end() or
+                _loops.at(it->second).size() > bbs.size())
+                _inner_header[bb] = header;
+        }
+    }
+}
+
+void FreqInfo::compute_probs() {
+    for (auto bb : _rpo) {
+        auto &sucs = bb->suc_bbs();
+        if (sucs.size() == 1) {
+            _prob[{bb, *sucs.begin()}] = 1;
+            continue;
+        }
+        if (sucs.size() != 2)
+            continue;
+        auto br = &bb->insts().back();
+        auto t = br->get_operand(1)->as<BasicBlock>();
+        auto f = br->get_operand(2)->as<BasicBlock>();
+        auto p = branch_prob(bb, t, f);
+        _prob[{bb, t}] = p;
+        _prob[{bb, f}] = 1 - p;
+    }
+}
+
+// the probability of going to t, each heuristic that tells t and f apart is
+// combined by Dempster-Shafer
+double FreqInfo::branch_prob(BasicBlock *bb, BasicBlock *t,
+                             BasicBlock *f) const {
+    double p = 0.5;
+    auto combine = [&](bool to_t, bool to_f, double likely, bool t_likely) {
+        if (to_t == to_f)
+            return;
+        auto q = (to_t == t_likely) ? likely : 1 - likely;
+        p = p * q / (p * q + (1 - p) * (1 - q));
+    };
+
+    // going back to the header of a loop
+    combine(is_back_edge(bb, t), is_back_edge(bb, f), loop_branch_prob, true);
+    // leaving the innermost loop
+    auto it = _inner_header.find(bb);
+    if (it != _inner_header.end()) {
+        auto &bbs = _loops.at(it->second);
+        combine(not ::contains(bbs, t), not ::contains(bbs, f),
+                loop_exit_prob, false);
+    }
+    // an early return
+    combine(is_returning(t), is_returning(f), return_prob, false);
+    // a call, e.g. to report an error
+    combine(has_call(t), has_call(f), call_prob, false);
+    // an integer being equal to a constant or negative
+    auto cond = bb->insts().back().get_operand(0);
+    if (cond->is<ICmpInst>() and cond->as<ICmpInst>()->rhs()->is<ConstInt>()) {
+        auto icmp = cond->as<ICmpInst>();
+        auto c = icmp->rhs()->as<ConstInt>()->val();
+        switch (icmp->get_icmp_op()) {
+        case ICmpInst::EQ:
+            combine(true, false, opcode_prob, false);
+            break;
+        case ICmpInst::NE:
+            combine(true, false, opcode_prob, true);
+            break;
+        case ICmpInst::LT:
+        case ICmpInst::LE:
+            if (c == 0)
+                combine(true, false, opcode_prob, false);
+            break;
+        case ICmpInst::GT:
+        case ICmpInst::GE:
+            if (c == 0)
+                combine(true, false, opcode_prob, true);
+            break;
+        }
+    }
+    return p;
+}
+
+double FreqInfo::prob(BasicBlock *from, BasicBlock *to) const {
+    auto it = _prob.find({from, to});
+    return it == _prob.end() ? 0 : it->second;
+}
+
+// region is nullptr for the whole function, whose head is the entry
+void FreqInfo::propagate(BasicBlock *head, const set<BasicBlock *> *region) {
+    set<BasicBlock *> done;
+    double back_prob = 0;
+    for (auto bb : _rpo) {
+        if (region and not ::contains(*region, bb))
+            continue;
+        double f = 0;
+        if (bb == head) {
+            f = 1;
+        } else {
+            for (auto pre : bb->pre_bbs()) {
+                if (::contains(done, pre) and not is_back_edge(pre, bb))
+                    f += _freq.at(pre) * prob(pre, bb);
+            }
+            auto it = _cyclic_prob.find(bb);
+            if (it != _cyclic_prob.end())
+                f /= 1 - it->second;
+        }
+        _freq[bb] = f;
+        done.insert(bb);
+        if (region and ::contains(bb->suc_bbs(), head))
+            back_prob += f * prob(bb, head);
+    }
+    if (region)
+        _cyclic_prob[head] = min(back_prob, max_cyclic_prob);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "basic_block.hh"
+#include "dominator.hh"
+#include "function.hh"
+#include "pass.hh"
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pass {
+
+/* static branch probabilities and block frequencies of one function
+ *
+ * the probability of a conditional branch combines the heuristics that apply
+ * to it (see Static Branch Frequency and Program Profile Analysis, Wu and
+ * Larus): a loop keeps going round, an early return, a call (e.g. an error
+ * message) and an equality test are unlikely
+ *
+ * the frequencies are relative to the entry, which is 1. each loop is visited
+ * from the innermost, the chance of getting back to its header is found by
+ * propagating the frequencies through the loop once, and the header is then
+ * scaled by 1 / (1 - that chance) in the enclosing loops
+ */
+class FreqInfo {
+  public:
+    void build(const DomTree &dom);
+
+    // the probability of going from `from` to its successor `to`
+    double prob(ir::BasicBlock *from, ir::BasicBlock *to) const;
+    // 0 for the bbs unreachable from the entry
+    double freq(ir::BasicBlock *bb) const {
+        auto it = _freq.find(bb);
+        return it == _freq.end() ? 0 : it->second;
+    }
+    double edge_freq(ir::BasicBlock *from, ir::BasicBlock *to) const {
+        return freq(from) * prob(from, to);
+    }
+    // the number of loops containing bb
+    unsigned loop_depth(ir::BasicBlock *bb) const {
+        auto it = _depth.find(bb);
+        return it == _depth.end() ? 0 : it->second;
+    }
+
+  private:
+    using Edge = std::pair<ir::BasicBlock *, ir::BasicBlock *>;
+
+    // reverse post order, only the reachable bbs
+    std::vector<ir::BasicBlock *> _rpo;
+    // (header, bbs in the loop)
+    std::unordered_map<ir::BasicBlock *, std::set<ir::BasicBlock *>> _loops;
+    std::unordered_map<ir::BasicBlock *, ir::BasicBlock *> _inner_header;
+    std::unordered_map<ir::BasicBlock *, unsigned> _depth;
+    std::map<Edge, double> _prob;
+    std::unordered_map<ir::BasicBlock *, double> _freq;
+    std::unordered_map<ir::BasicBlock *, double> _cyclic_prob;
+
+    void find_loops(const DomTree &dom);
+    void compute_probs();
+    double branch_prob(ir::BasicBlock *bb, ir::BasicBlock *t,
+                       ir::BasicBlock *f) const;
+    // propagate the frequencies from head through the bbs in region
+    void propagate(ir::BasicBlock *head,
+                   const std::set<ir::BasicBlock *> *region);
+
+    bool is_back_edge(ir::BasicBlock *from, ir::BasicBlock *to) const {
+        auto it = _loops.find(to);
+        return it != _loops.end() and ::contains(it->second, from);
+    }
+};
+
+class BlockFrequency final : public AnalysisPass {
+  public:
+    struct ResultType {
+        std::unordered_map<ir::Function *, FreqInfo> freqs;
+
+        const FreqInfo &at(ir::Function *f) const { return freqs.at(f); }
+        double freq(ir::BasicBlock *bb) const {
+            return at(bb->get_func()).freq(bb);
+        }
+    };
+
+    void get_analysis_usage(AnalysisUsage &AU) const final {
+        using KillType = AnalysisUsage::KillType;
+        AU.set_kill_type(KillType::None);
+        AU.add_require<Dominator>();
+    }
+
+    std::any get_result() const final { return &_result; }
+
+    bool run(PassManager *mgr) final;
+
+    void clear() final { _result.freqs.clear(); }
+
+  private:
+    ResultType _result;
+};
+
+} // namespace pass
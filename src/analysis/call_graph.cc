@@ -0,0 +1,202 @@
+#include "call_graph.hh"
+#include "basic_block.hh"
+#include "utils.hh"
+#include <algorithm>
+#include <cassert>
+#include <set>
+#include <utility>
+
+using namespace pass;
+using namespace ir;
+using namespace std;
+
+bool CallGraph::run(PassManager *mgr) {
+    clear();
+    _result.build(mgr->get_module());
+    return false;
+}
+
+using ResultType = CallGraph::ResultType;
+
+void ResultType::build(Module *m) {
+    _module = m;
+    for (auto &f_r : m->functions()) {
+        _funcs.push_back(&f_r);
+        _nodes[&f_r];
+    }
+    for (auto f : _funcs) {
+        for (auto &bb_r : f->bbs()) {
+            for (auto &inst_r : bb_r.insts()) {
+                if (inst_r.is<CallInst>())
+                    add_call(inst_r.as<CallInst>());
+            }
+        }
+    }
+    _dirty = true;
+}
+
+vector<Function *> ResultType::callees(Function *f) const {
+    vector<Function *> ret;
+    set<Function *> visited;
+    for (auto call : call_sites(f)) {
+        auto callee = call->get_operand(0)->as<Function>();
+        if (visited.insert(callee).second)
+            ret.push_back(callee);
+    }
+    return ret;
+}
+
+unsigned ResultType::scc(Function *f) const {
+    if (_dirty)
+        compute_sccs();
+    return _scc_id.at(f);
+}
+
+const vector<vector<Function *>> &ResultType::sccs() const {
+    if (_dirty)
+        compute_sccs();
+    return _sccs;
+}
+
+vector<Function *> ResultType::bottom_up() const {
+    vector<Function *> ret;
+    for (auto &scc : sccs()) {
+        ret.insert(ret.end(), scc.begin(), scc.end());
+    }
+    return ret;
+}
+
+vector<Function *> ResultType::top_down() const {
+    auto ret = bottom_up();
+    reverse(ret.begin(), ret.end());
+    return ret;
+}
+
+bool ResultType::is_recursive(Function *f) const {
+    if (sccs()[scc(f)].size() > 1)
+        return true;
+    auto &calls = call_sites(f);
+    return any_of(calls.begin(), calls.end(), [&](CallInst *call) {
+        return call->get_operand(0) == f;
+    });
+}
+
+void ResultType::add_call(CallInst *call) {
+    auto caller = call->get_parent()->get_func();
+    auto callee = call->get_operand(0)->as<Function>();
+    _nodes.at(caller).calls.push_back(call);
+    _nodes.at(callee).callers.push_back(call);
+    // an edge to a lower scc never closes a cycle
+    if (not _dirty and _scc_id.at(callee) > _scc_id.at(caller))
+        _dirty = true;
+}
+
+void ResultType::remove_call(CallInst *call) {
+    auto caller = call->get_parent()->get_func();
+    auto callee = call->get_operand(0)->as<Function>();
+    auto erase_one = [&](vector<CallInst *> &calls) {
+        auto it = find(calls.begin(), calls.end(), call);
+        assert(it != calls.end());
+        calls.erase(it);
+    };
+    erase_one(_nodes.at(caller).calls);
+    erase_one(_nodes.at(callee).callers);
+    // the scc may be split
+    if (not _dirty and caller != callee and
+        _scc_id.at(callee) == _scc_id.at(caller))
+        _dirty = true;
+}
+
+void ResultType::remove_function(Function *f) {
+    assert(callers(f).empty());
+    // copied, as remove_call edits the list
+    auto calls = call_sites(f);
+    for (auto call : calls) {
+        remove_call(call);
+    }
+    _nodes.erase(f);
+    _funcs.erase(find(_funcs.begin(), _funcs.end(), f));
+    // the numbering is still valid, but has a hole in it
+    _dirty = true;
+}
+
+// Tarjan's algorithm, an scc is popped after all the sccs it calls
+void ResultType::compute_sccs() const {
+    _sccs.clear();
+    _scc_id.clear();
+    unordered_map<Function *, unsigned> index, low;
+    vector<Function *> stack;
+    set<Function *> on_stack;
+    unsigned clock{0};
+
+    // the frames of the DFS: the function and the next call to visit
+    vector<pair<Function *, size_t>> frames;
+    for (auto root : _funcs) {
+        if (::contains(index, root))
+            continue;
+        frames.push_back({root, 0});
+        index[root] = low[root] = clock++;
+        stack.push_back(root);
+        on_stack.insert(root);
+        while (not frames.empty()) {
+            auto &[f, next] = frames.back();
+            auto &calls = _nodes.at(f).calls;
+            if (next < calls.size()) {
+                auto callee = calls[next++]->get_operand(0)->as<Function>();
+                if (not ::contains(index, callee)) {
+                    index[callee] = low[callee] = clock++;
+                    stack.push_back(callee);
+                    on_stack.insert(callee);
+                    frames.push_back({callee, 0});
+                } else if (::contains(on_stack, callee)) {
+                    low[f] = min(low[f], index[callee]);
+                }
+                continue;
+            }
+            auto done = f;
+            frames.pop_back();
+            if (not frames.empty()) {
+                auto parent = frames.back().first;
+                low[parent] = min(low[parent], low[done]);
+            }
+            if (low[done] != index[done])
+                continue;
+            vector<Function *> scc;
+            Function *member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                on_stack.erase(member);
+                _scc_id[member] = _sccs.size();
+                scc.push_back(member);
+            } while (member != done);
+            _sccs.push_back(std::move(scc));
+        }
+    }
+    _dirty = false;
+}
+
+bool ResultType::verify() const {
+    ResultType fresh;
+    fresh.build(_module);
+    if (fresh._funcs != _funcs)
+        return false;
+    auto same_calls = [](vector<CallInst *> lhs, vector<CallInst *> rhs) {
+        sort(lhs.begin(), lhs.end());
+        sort(rhs.begin(), rhs.end());
+        return lhs == rhs;
+    };
+    for (auto f : _funcs) {
+        if (not same_calls(call_sites(f), fresh.call_sites(f)) or
+            not same_calls(callers(f), fresh.callers(f)))
+            return false;
+    }
+    for (auto f : _funcs) {
+        for (auto callee : callees(f)) {
+            bool same = fresh.scc(f) == fresh.scc(callee);
+            if (same != (scc(f) == scc(callee)) or scc(callee) > scc(f))
+                return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "function.hh"
+#include "instruction.hh"
+#include "module.hh"
+#include "pass.hh"
+#include <unordered_map>
+#include <vector>
+
+namespace pass {
+
+/* call graph of the module, with its strongly connected components found by
+ * Tarjan's algorithm
+ *
+ * sccs are numbered bottom up: an scc only calls into itself or sccs with
+ * smaller numbers, so walking them by number visits callees before callers
+ *
+ * transform passes that add or remove calls keep the graph up to date with
+ * add_call/remove_call/remove_function instead of killing CallGraph. an edit
+ * that may break the numbering (a new edge going up, or a removed edge inside
+ * an scc) only marks the sccs dirty, they are recomputed on the next query
+ */
+class CallGraph final : public AnalysisPass {
+  public:
+    class ResultType {
+        friend class CallGraph;
+
+      public:
+        // the calls in f, in the order they are found
+        const std::vector<ir::CallInst *> &call_sites(ir::Function *f) const {
+            return _nodes.at(f).calls;
+        }
+        // the calls to f
+        const std::vector<ir::CallInst *> &callers(ir::Function *f) const {
+            return _nodes.at(f).callers;
+        }
+        // distinct callees of f
+        std::vector<ir::Function *> callees(ir::Function *f) const;
+
+        unsigned scc(ir::Function *f) const;
+        // sccs in bottom up order
+        const std::vector<std::vector<ir::Function *>> &sccs() const;
+        std::vector<ir::Function *> bottom_up() const;
+        std::vector<ir::Function *> top_down() const;
+        // f calls itself, directly or through other functions
+        bool is_recursive(ir::Function *f) const;
+
+        void add_call(ir::CallInst *call);
+        // before the call is erased
+        void remove_call(ir::CallInst *call);
+        // before f is erased, f should not be called anymore
+        void remove_function(ir::Function *f);
+
+        // compare with a graph built from scratch
+        bool verify() const;
+
+      private:
+        struct Node {
+            std::vector<ir::CallInst *> calls, callers;
+        };
+        ir::Module *_module{nullptr};
+        // functions in module order, so that the numbering is deterministic
+        std::vector<ir::Function *> _funcs;
+        std::unordered_map<ir::Function *, Node> _nodes;
+
+        mutable bool _dirty{true};
+        mutable std::vector<std::vector<ir::Function *>> _sccs;
+        mutable std::unordered_map<ir::Function *, unsigned> _scc_id;
+
+        void build(ir::Module *m);
+        void compute_sccs() const;
+    };
+
+    void get_analysis_usage(AnalysisUsage &AU) const final {
+        using KillType = AnalysisUsage::KillType;
+        AU.set_kill_type(KillType::None);
+    }
+
+    std::any get_result() const final { return &_result; }
+
+    bool run(PassManager *mgr) final;
+
+    void clear() final {
+        _result._module = nullptr;
+        _result._funcs.clear();
+        _result._nodes.clear();
+        _result._dirty = true;
+        _result._sccs.clear();
+        _result._scc_id.clear();
+    }
+
+  private:
+    ResultType _result;
+};
+
+} // namespace pass
@@ -0,0 +1,391 @@
+#include "dependence.hh"
+#include "err.hh"
+#include "function.hh"
+#include "type.hh"
+#include "utils.hh"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+
+using namespace pass;
+using namespace ir;
+using namespace std;
+
+namespace {
+
+// at most 3^6 direction vectors are enumerated
+constexpr size_t MAX_LEVELS = 6;
+
+// how many int/float elements a value of the type takes
+int elem_cnt(Type *type) {
+    if (type->is<ArrayType>())
+        return type->as<ArrayType>()->get_total_cnt();
+    return 1;
+}
+
+Value *ptr_of(Instruction *inst) {
+    if (inst->is<LoadInst>())
+        return inst->as<LoadInst>()->ptr();
+    return inst->as<StoreInst>()->ptr();
+}
+
+// the direction of a level in a vector encoded in base 3
+uint8_t dir_at(size_t vec, size_t level) {
+    for (size_t i = 0; i < level; ++i)
+        vec /= 3;
+    return static_cast<uint8_t>(1 << (vec % 3));
+}
+
+/* [lo, hi] of a * i - b * j, where 0 <= i, j <= u and i, j are in the
+ * direction dir, nullopt for no bound. the extremes of a linear function are
+ * on the vertices of the polygon of (i, j), which are (x0 + x1 * u, y0 + y1 *
+ * u). if u is unknown, it may be anything >= 1
+ */
+struct Range {
+    optional<int64_t> lo{0}, hi{0};
+
+    Range operator+(const Range &rhs) const {
+        Range ret;
+        ret.lo = lo and rhs.lo ? optional{*lo + *rhs.lo} : nullopt;
+        ret.hi = hi and rhs.hi ? optional{*hi + *rhs.hi} : nullopt;
+        return ret;
+    }
+    bool contains(int64_t c) const {
+        return (not lo or *lo <= c) and (not hi or c <= *hi);
+    }
+};
+
+Range vertex_range(int64_t a, int64_t b, optional<int> u,
+                   const vector<array<int, 4>> &vertices) {
+    Range ret{INT64_MAX, INT64_MIN};
+    for (auto [x0, x1, y0, y1] : vertices) {
+        int64_t p = a * x0 - b * y0, q = a * x1 - b * y1;
+        if (u.has_value()) {
+            auto v = p + q * u.value();
+            ret.lo = min(*ret.lo, v);
+            ret.hi = max(*ret.hi, v);
+            continue;
+        }
+        if (q < 0)
+            ret.lo = nullopt;
+        else if (ret.lo)
+            ret.lo = min(*ret.lo, p + q);
+        if (q > 0)
+            ret.hi = nullopt;
+        else if (ret.hi)
+            ret.hi = max(*ret.hi, p + q);
+    }
+    return ret;
+}
+
+Range level_range(int64_t a, int64_t b, uint8_t dir, optional<int> u) {
+    switch (dir) {
+    case DirEQ:
+        return vertex_range(a, b, u, {{0, 0, 0, 0}, {0, 1, 0, 1}});
+    case DirLT:
+        return vertex_range(a, b, u,
+                            {{0, 0, 1, 0}, {0, 0, 0, 1}, {-1, 1, 0, 1}});
+    case DirGT:
+        return vertex_range(a, b, u,
+                            {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 1, -1, 1}});
+    }
+    throw unreachable_error{};
+}
+
+// a * i for 0 <= i <= u, a loop of only one of the accesses
+Range single_range(int64_t a, optional<int> u) {
+    return vertex_range(a, 0, u, {{0, 0, 0, 0}, {0, 1, 0, 0}});
+}
+
+} // namespace
+
+bool DependenceAnalysis::run(PassManager *mgr) {
+    clear();
+    _result._loops = &mgr->get_result<LoopFind>();
+    _result._scev = &mgr->get_result<ScalarEvolution>();
+    _result._alias = &mgr->get_result<AliasAnalysis>();
+    _result._func_info = &mgr->get_result<FuncInfo>();
+    return false;
+}
+
+using ResultType = DependenceAnalysis::ResultType;
+
+vector<BasicBlock *> ResultType::loops_of(BasicBlock *bb) const {
+    auto &func_loops = _loops->loop_info.at(bb->get_func());
+    vector<BasicBlock *> ret;
+    for (auto loop = func_loops.loop_of(bb); loop;
+         loop = loop->parent ? &func_loops.loops.at(loop->parent) : nullptr)
+        ret.push_back(loop->header);
+    reverse(ret.begin(), ret.end());
+    return ret;
+}
+
+optional<int> ResultType::bound(BasicBlock *header) const {
+    auto n = _scev->trip_count(header);
+    if (not n.has_value() or not n->is_const() or n->const_val() < 0)
+        return nullopt;
+    return n->const_val();
+}
+
+// the terms evolving in loops are replaced by the iteration counts, depth
+// limits the cost on long chains of recurrences
+bool ResultType::to_subscript(const LinearExpr &expr, int mul, Subscript &sub,
+                              unsigned depth) const {
+    if (depth == 0)
+        return false;
+    sub.sym = sub.sym + LinearExpr{expr.constant * mul};
+    for (auto [v, k] : expr.terms) {
+        auto rec = _scev->get(v);
+        if (not rec.has_value())
+            return false;
+        if (rec->is_invariant() and rec->start == LinearExpr::of(v)) {
+            sub.sym = sub.sym + LinearExpr::of(v) * (k * mul);
+            continue;
+        }
+        if (not rec->is_invariant()) {
+            if (not rec->step.is_const())
+                return false;
+            sub.coefs[rec->loop] += rec->step.constant * k * mul;
+        }
+        if (not to_subscript(rec->start, k * mul, sub, depth - 1))
+            return false;
+    }
+    return true;
+}
+
+ResultType::Access ResultType::access(Instruction *inst) const {
+    Access ret;
+    ret.loops = loops_of(inst->get_parent());
+
+    // (stride, index) in the gep chain, the outermost dimension is the last
+    vector<pair<int, Value *>> indices;
+    ret.base = ptr_of(inst);
+    while (ret.base->is<GetElementPtrInst>()) {
+        auto gep = ret.base->as<GetElementPtrInst>();
+        ret.base = gep->base_ptr();
+        auto type = ret.base->get_type()->as<PointerType>()->get_elem_type();
+        vector<pair<int, Value *>> gep_indices;
+        for (unsigned i = 1; i < gep->operands().size(); ++i) {
+            gep_indices.push_back({elem_cnt(type), gep->get_operand(i)});
+            if (type->is<ArrayType>())
+                type = type->as<ArrayType>()->get_elem_type();
+        }
+        indices.insert(indices.end(), gep_indices.rbegin(),
+                       gep_indices.rend());
+    }
+    if (indices.empty()) {
+        ret.strides.push_back(1);
+        ret.dims.push_back({});
+    }
+    for (auto it = indices.rbegin(); it != indices.rend(); ++it) {
+        auto [stride, index] = *it;
+        if (ret.strides.empty() or ret.strides.back() != stride) {
+            ret.strides.push_back(stride);
+            ret.dims.push_back({});
+        }
+        ret.affine &= to_subscript(LinearExpr::of(index), 1, ret.dims.back(),
+                                   8);
+    }
+    // the symbolic parts must not change in the loops
+    if (not ret.loops.empty()) {
+        for (auto &dim : ret.dims)
+            ret.affine &= _scev->is_invariant(dim.sym, ret.loops.front());
+    }
+    return ret;
+}
+
+bool ResultType::test(const Subscript &src, const Subscript &dst,
+                      const Access &src_acc, const Access &dst_acc,
+                      size_t levels, vector<bool> &feasible,
+                      vector<optional<int>> &distances) const {
+    auto diff = dst.sym - src.sym;
+    if (not diff.is_const())
+        return true;
+    // a * i - b * j = c
+    int64_t c = diff.constant;
+
+    // the coefficients of the common loops, and the ranges of the terms of
+    // the loops containing only one of the accesses
+    vector<int64_t> a(levels, 0), b(levels, 0);
+    Range others;
+    int64_t g = 0;
+    auto add = [&](const Subscript &sub, const Access &acc, bool is_src) {
+        for (auto [loop, k] : sub.coefs) {
+            auto it = find(acc.loops.begin(), acc.loops.end(), loop);
+            if (it == acc.loops.end())
+                return false;
+            g = gcd(g, llabs(static_cast<int64_t>(k)));
+            size_t level = it - acc.loops.begin();
+            if (level < levels)
+                (is_src ? a : b)[level] = k;
+            else
+                others = others + single_range(is_src ? k : -k, bound(loop));
+        }
+        return true;
+    };
+    // evolves in a loop that is already done, e.g. by its exit value
+    if (not add(src, src_acc, true) or not add(dst, dst_acc, false))
+        return true;
+
+    // ZIV and GCD
+    if (g == 0)
+        return c == 0;
+    if (c % g != 0)
+        return false;
+
+    // strong SIV: a * i - a * j = c, so j - i = -c / a
+    optional<size_t> siv_level;
+    bool is_siv = others.lo == 0 and others.hi == 0;
+    for (size_t i = 0; i < levels; ++i) {
+        if (a[i] == 0 and b[i] == 0)
+            continue;
+        is_siv &= not siv_level.has_value() and a[i] == b[i];
+        siv_level = i;
+    }
+    optional<int64_t> dist;
+    if (is_siv and siv_level.has_value()) {
+        auto l = *siv_level;
+        if (c % a[l] != 0)
+            return false;
+        dist = -c / a[l];
+        auto u = bound(src_acc.loops[l]);
+        if (u.has_value() and llabs(*dist) > *u)
+            return false;
+        distances[l] = *dist;
+    }
+
+    // Banerjee
+    bool any = false;
+    for (size_t vec = 0; vec < feasible.size(); ++vec) {
+        if (not feasible[vec])
+            continue;
+        auto range = others;
+        for (size_t i = 0; i < levels; ++i) {
+            auto dir = dir_at(vec, i);
+            auto u = bound(src_acc.loops[i]);
+            if (dir != DirEQ and u.has_value() and *u < 1) {
+                range.lo = 1;
+                range.hi = 0;
+                break;
+            }
+            range = range + level_range(a[i], b[i], dir, u);
+        }
+        if (dist.has_value()) {
+            auto dir = dir_at(vec, *siv_level);
+            auto expected = *dist > 0 ? DirLT : *dist == 0 ? DirEQ : DirGT;
+            if (dir != expected) {
+                feasible[vec] = false;
+                continue;
+            }
+        }
+        feasible[vec] = range.contains(c);
+        any |= feasible[vec];
+    }
+    return any;
+}
+
+optional<Dependence> ResultType::depend(Instruction *src,
+                                        Instruction *dst) const {
+    // the subscripts of the same base are compared below, as the same value
+    // is not the same number in different iterations
+    auto src_loc = _alias->location(ptr_of(src)),
+         dst_loc = _alias->location(ptr_of(dst));
+    if (src_loc.base != dst_loc.base and
+        _alias->alias_at_any_time(src_loc, dst_loc) == AliasResult::NoAlias)
+        return nullopt;
+
+    auto src_acc = access(src), dst_acc = access(dst);
+    Dependence dep{src, dst};
+    for (size_t i = 0;
+         i < min(src_acc.loops.size(), dst_acc.loops.size()) and
+         src_acc.loops[i] == dst_acc.loops[i];
+         ++i)
+        dep.loops.push_back(src_acc.loops[i]);
+    auto levels = dep.loops.size();
+    dep.directions.assign(levels, DirAll);
+    dep.distances.assign(levels, nullopt);
+
+    if (src_acc.base != dst_acc.base or not src_acc.affine or
+        not dst_acc.affine or levels > MAX_LEVELS) {
+        dep.confused = true;
+        return dep;
+    }
+
+    // test the dimensions one by one if the shapes are the same, or the
+    // linearized subscripts otherwise
+    vector<pair<Subscript, Subscript>> pairs;
+    if (src_acc.strides == dst_acc.strides) {
+        for (size_t i = 0; i < src_acc.dims.size(); ++i)
+            pairs.push_back({src_acc.dims[i], dst_acc.dims[i]});
+    } else {
+        auto linearize = [](const Access &acc) {
+            Subscript ret;
+            for (size_t i = 0; i < acc.dims.size(); ++i) {
+                ret.sym = ret.sym + acc.dims[i].sym * acc.strides[i];
+                for (auto [loop, k] : acc.dims[i].coefs)
+                    ret.coefs[loop] += k * acc.strides[i];
+            }
+            return ret;
+        };
+        pairs.push_back({linearize(src_acc), linearize(dst_acc)});
+    }
+
+    size_t vec_cnt = 1;
+    for (size_t i = 0; i < levels; ++i)
+        vec_cnt *= 3;
+    vector<bool> feasible(vec_cnt, true);
+    for (auto &[s, d] : pairs) {
+        vector<optional<int>> distances(levels);
+        if (not test(s, d, src_acc, dst_acc, levels, feasible, distances))
+            return nullopt;
+        for (size_t i = 0; i < levels; ++i)
+            if (distances[i].has_value())
+                dep.distances[i] = distances[i];
+    }
+
+    fill(dep.directions.begin(), dep.directions.end(), 0);
+    for (size_t vec = 0; vec < vec_cnt; ++vec) {
+        if (not feasible[vec])
+            continue;
+        for (size_t i = 0; i < levels; ++i)
+            dep.directions[i] |= dir_at(vec, i);
+    }
+    for (size_t i = 0; i < levels; ++i)
+        if (dep.directions[i] == DirEQ)
+            dep.distances[i] = 0;
+    return dep;
+}
+
+optional<vector<Dependence>>
+ResultType::loop_dependences(BasicBlock *header) const {
+    auto func = header->get_func();
+    auto &func_loops = _loops->loop_info.at(func);
+    vector<Instruction *> accesses;
+    for (auto &bb : func->bbs()) {
+        if (not func_loops.in_loop(&bb, header))
+            continue;
+        for (auto &inst : bb.insts()) {
+            if (inst.is<LoadInst>() or inst.is<StoreInst>())
+                accesses.push_back(&inst);
+            if (inst.is<CallInst>()) {
+                auto callee = inst.get_operand(0)->as<Function>();
+                if (not _func_info->is_pure_function(callee))
+                    return nullopt;
+            }
+        }
+    }
+    vector<Dependence> ret;
+    for (size_t i = 0; i < accesses.size(); ++i) {
+        for (size_t j = i; j < accesses.size(); ++j) {
+            auto src = accesses[i], dst = accesses[j];
+            if (not src->is<StoreInst>() and not dst->is<StoreInst>())
+                continue;
+            auto dep = depend(src, dst);
+            if (dep.has_value())
+                ret.push_back(std::move(dep.value()));
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "alias_analysis.hh"
+#include "basic_block.hh"
+#include "func_info.hh"
+#include "instruction.hh"
+#include "loop_find.hh"
+#include "pass.hh"
+#include "scalar_evolution.hh"
+#include "value.hh"
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace pass {
+
+// the iteration of dst compared with the one of src in a loop, as a set
+enum Direction : uint8_t {
+    DirLT = 1, // dst runs in a later iteration
+    DirEQ = 2,
+    DirGT = 4, // dst runs in an earlier iteration
+    DirAll = DirLT | DirEQ | DirGT,
+};
+
+/* a possible dependence between two memory accesses, one of which is a store
+ *
+ * for each loop containing both of them, outermost first, the directions
+ * (and the distance if it is a constant) of the iterations in which the two
+ * access the same element
+ */
+struct Dependence {
+    ir::Instruction *src, *dst;
+    std::vector<ir::BasicBlock *> loops;
+    std::vector<uint8_t> directions;
+    // dst iteration - src iteration
+    std::vector<std::optional<int>> distances;
+    // nothing is known about the subscripts, all directions are possible
+    bool confused{false};
+
+    bool is_loop_independent() const {
+        for (auto dir : directions)
+            if (dir != DirEQ)
+                return false;
+        return true;
+    }
+};
+
+/* dependence analysis of the array accesses in loop nests
+ *
+ * a subscript is taken as c + a1 * k1 + a2 * k2 + ..., where ki counts the
+ * iterations of the loop i from 0 (see Optimizing Compilers for Modern
+ * Architectures, Allen and Kennedy). a multi-dimensional access is tested
+ * dimension by dimension if both accesses use the same shape, which assumes
+ * that each index is in the bounds of its dimension
+ *
+ * each subscript is tested by ZIV, strong SIV (giving the exact distance) and
+ * GCD, then the Banerjee inequalities are checked for every direction vector,
+ * with the constant trip counts as the bounds of the loops. the direction
+ * vectors that no subscript rules out are merged into the result
+ *
+ * the results are computed on query from the loops and the recurrences
+ */
+class DependenceAnalysis final : public AnalysisPass {
+  public:
+    class ResultType {
+        friend class DependenceAnalysis;
+
+      public:
+        // nullopt if the two accesses never touch the same element
+        std::optional<Dependence> depend(ir::Instruction *src,
+                                         ir::Instruction *dst) const;
+        // the dependences between the loads and stores in the loop, in the
+        // order of the insts, nullopt if the loop calls a function that
+        // touches memory or does I/O
+        std::optional<std::vector<Dependence>>
+        loop_dependences(ir::BasicBlock *header) const;
+
+      private:
+        // c + a1 * k1 + ..., the symbolic part is invariant in all the loops
+        struct Subscript {
+            LinearExpr sym;
+            std::map<ir::BasicBlock *, int> coefs;
+        };
+        // the subscript of each dimension, the outermost first
+        struct Access {
+            ir::Value *base;
+            std::vector<int> strides;
+            std::vector<Subscript> dims;
+            // the loops containing the access, the outermost first
+            std::vector<ir::BasicBlock *> loops;
+            // some subscript is not affine
+            bool affine{true};
+        };
+
+        const LoopFind::ResultType *_loops{nullptr};
+        const ScalarEvolution::ResultType *_scev{nullptr};
+        const AliasAnalysis::ResultType *_alias{nullptr};
+        const FuncInfo::ResultType *_func_info{nullptr};
+
+        Access access(ir::Instruction *inst) const;
+        std::vector<ir::BasicBlock *> loops_of(ir::BasicBlock *bb) const;
+        bool to_subscript(const LinearExpr &expr, int mul, Subscript &sub,
+                          unsigned depth) const;
+        // the number of times the header runs - 1, nullopt if unknown
+        std::optional<int> bound(ir::BasicBlock *header) const;
+        // rule out the direction vectors (encoded in base 3) of the common
+        // loops in feasible, false if none is left. the distance found by
+        // strong SIV is recorded
+        bool test(const Subscript &src, const Subscript &dst,
+                  const Access &src_acc, const Access &dst_acc, size_t levels,
+                  std::vector<bool> &feasible,
+                  std::vector<std::optional<int>> &distances) const;
+    };
+
+    void get_analysis_usage(AnalysisUsage &AU) const final {
+        using KillType = AnalysisUsage::KillType;
+        AU.set_kill_type(KillType::None);
+        AU.add_require<LoopFind>();
+        AU.add_require<ScalarEvolution>();
+        AU.add_require<AliasAnalysis>();
+        AU.add_require<FuncInfo>();
+    }
+
+    std::any get_result() const final { return &_result; }
+
+    bool run(PassManager *mgr) final;
+
+    void clear() final {
+        _result._loops = nullptr;
+        _result._scev = nullptr;
+        _result._alias = nullptr;
+        _result._func_info = nullptr;
+    }
+
+  private:
+    ResultType _result;
+};
+
+} // namespace pass
@@ -1,144 +1,406 @@
 #include "dominator.hh"
 #include "basic_block.hh"
+#include "instruction.hh"
+#include "remove_unreach_bb.hh"
+#include "user.hh"
 #include "utils.hh"
+#include <algorithm>
 #include <cassert>
 #include <queue>
+#include <unordered_set>
 using namespace ir;
 using namespace pass;
+using namespace std;
+
+void Dominator::get_analysis_usage(AnalysisUsage &AU) const {
+    using KillType = AnalysisUsage::KillType;
+    AU.set_kill_type(KillType::None);
+    AU.add_require<RmUnreachBB>();
+}
 
 bool Dominator::run(PassManager *mgr) {
     clear();
-    _depth_order = &mgr->get_result<DepthOrder>();
     auto m = mgr->get_module();
     for (auto &f_r : m->functions()) {
-        f = &f_r;
+        auto f = &f_r;
         if (f->is_external)
             continue;
-        // init
-        for (auto &bb_r : f->bbs()) {
-            auto bb = &bb_r;
-            _idom.insert({bb, nullptr});
-            _result.dom_frontier.insert({bb, {}});
-            _result.dom_tree_succ_blocks.insert({bb, {}});
-        }
-
-        create_idom(f);
-        create_dominance_frontier(f);
-        create_dom_tree_succ(f);
+        _result.dom_tree[f].build(f);
     }
     return false;
 }
 
-void Dominator::create_idom(Function *f) {
-    auto root = f->get_entry_bb();
-    _idom[root] = root;
+// bbs reachable from `root` without leaving the region, in reverse post order
+template <typename InRegion>
+static vector<BasicBlock *> reverse_post_order(BasicBlock *root,
+                                               InRegion in_region) {
+    vector<BasicBlock *> post_order;
+    unordered_set<BasicBlock *> visited{root};
+    using SucIter = set<BasicBlock *>::const_iterator;
+    vector<pair<BasicBlock *, SucIter>> stack{{root, root->suc_bbs().begin()}};
+    while (not stack.empty()) {
+        auto &[bb, it] = stack.back();
+        if (it == bb->suc_bbs().end()) {
+            post_order.push_back(bb);
+            stack.pop_back();
+            continue;
+        }
+        auto suc = *it++;
+        if (not contains(visited, suc) and in_region(suc)) {
+            visited.insert(suc);
+            stack.push_back({suc, suc->suc_bbs().begin()});
+        }
+    }
+    return {post_order.rbegin(), post_order.rend()};
+}
+
+// A Simple, Fast Dominance Algorithm, Cooper et al.
+// the idom of each bb in `rpo` except rpo[0], the root of the region
+static vector<BasicBlock *> compute_idom(const vector<BasicBlock *> &rpo) {
+    auto n = rpo.size();
+    unordered_map<BasicBlock *, unsigned> number;
+    for (unsigned i = 0; i < n; ++i) {
+        number[rpo[i]] = i;
+    }
+    // edges from/to bbs out of the region are dropped
+    vector<vector<unsigned>> preds(n);
+    for (unsigned i = 1; i < n; ++i) {
+        for (auto pre : rpo[i]->pre_bbs()) {
+            auto it = number.find(pre);
+            if (it != number.end())
+                preds[i].push_back(it->second);
+        }
+    }
+
+    constexpr unsigned UNDEF = -1;
+    vector<unsigned> idom(n, UNDEF);
+    idom[0] = 0;
+    auto intersect = [&](unsigned a, unsigned b) {
+        // bb with a greater rpo number is a deeper or equal depth node in CFG
+        while (a != b) {
+            while (a > b)
+                a = idom[a];
+            while (b > a)
+                b = idom[b];
+        }
+        return a;
+    };
 
     bool changed = true;
-    unsigned exc_times = 0;
     while (changed) {
-        exc_times++;
-        if (exc_times > 2) {
-            // I think the method working out the idom of bb in a depth-first
-            // order can excute once to get an right solution(has been verified
-            // for non-goto)
-            assert(false);
-            // FIXME:after testing, this can be deleted.
-        }
         changed = false;
-        for (auto bb : _depth_order->_depth_priority_order.at(f)) {
-            if (bb == root) {
-                continue;
-            }
-            BasicBlock *pred;
-            for (auto p : bb->pre_bbs()) {
-                if (_idom[p]) {
-                    pred = p;
-                    break;
-                }
-            }
-            assert(pred);
-            // get the common pred of all pre_bb of current node
-            //(the idom of current node)
-            BasicBlock *new_idom = pred;
-            for (auto p : bb->pre_bbs()) {
-                if (_idom[p]) { // _idom[p]==nullptr means that p comes after bb
-                    // in depth-first order
-                    new_idom = intersect(p, new_idom);
-                }
+        for (unsigned i = 1; i < n; ++i) {
+            unsigned new_idom = UNDEF;
+            for (auto p : preds[i]) {
+                // idom[p] == UNDEF means that p has not been processed yet
+                if (idom[p] == UNDEF)
+                    continue;
+                new_idom = new_idom == UNDEF ? p : intersect(p, new_idom);
             }
-            assert(new_idom);
-            if (_idom[bb] != new_idom) {
-                _idom[bb] = new_idom;
+            assert(new_idom != UNDEF);
+            if (idom[i] != new_idom) {
+                idom[i] = new_idom;
                 changed = true;
             }
         }
     }
+
+    vector<BasicBlock *> ret(n, nullptr);
+    for (unsigned i = 1; i < n; ++i) {
+        ret[i] = rpo[idom[i]];
+    }
+    return ret;
 }
 
-BasicBlock *Dominator::intersect(BasicBlock *b1, BasicBlock *b2) {
-    // for nullptr, return the non-nullptr value
-    if (not b1)
-        return b2;
-    if (not b2)
-        return b1;
-    while (b1 != b2) {
-        // bb with a lower post_order_id is a deeper or equal depth node in CFG
-        while (_depth_order->_post_order_id.at(f).at(b1) <
-               _depth_order->_post_order_id.at(f).at(b2)) {
-            assert(_idom[b1]);
-            b1 = _idom[b1];
+void DomTree::build(Function *f) {
+    _func = f;
+    auto rpo = reverse_post_order(f->get_entry_bb(),
+                                  [](BasicBlock *) { return true; });
+    auto idoms = compute_idom(rpo);
+    rebuild(std::move(rpo), idoms);
+}
+
+void DomTree::apply_updates(const vector<Update> &updates) {
+    // edges between bbs out of the tree change nothing, otherwise only the
+    // subtree of the nearest common dominator of the endpoints is affected
+    BasicBlock *root{nullptr};
+    for (auto &&[kind, from, to] : updates) {
+        for (auto bb : {from, to}) {
+            if (not contains(bb))
+                continue;
+            root = root == nullptr ? bb : common_dominator(root, bb);
         }
-        while (_depth_order->_post_order_id.at(f).at(b2) <
-               _depth_order->_post_order_id.at(f).at(b1)) {
-            assert(_idom[b2]);
-            b2 = _idom[b2];
+    }
+    if (root == nullptr)
+        return;
+
+    vector<BasicBlock *> region;
+    while (true) {
+        auto r = number(root);
+        region = reverse_post_order(root, [&](BasicBlock *bb) {
+            auto it = _number.find(bb);
+            return it == _number.end() or dominates(r, it->second);
+        });
+        auto wider = widen(root, region);
+        if (wider == root)
+            break;
+        root = wider;
+    }
+
+    // idoms out of the region are unchanged, bbs of the old subtree that are
+    // not reached again are unreachable now and dropped
+    auto r = number(root);
+    auto region_idoms = compute_idom(region);
+    region_idoms[0] = idom(root);
+    vector<BasicBlock *> bbs, idoms;
+    bbs.reserve(_bbs.size() + region.size());
+    idoms.reserve(_bbs.size() + region.size());
+    for (Index i = 0; i < _bbs.size(); ++i) {
+        if (i == r) {
+            bbs.insert(bbs.end(), region.begin(), region.end());
+            idoms.insert(idoms.end(), region_idoms.begin(), region_idoms.end());
+        } else if (not dominates(r, i)) {
+            bbs.push_back(_bbs[i]);
+            idoms.push_back(i == 0 ? nullptr : _bbs[_idom[i]]);
         }
     }
-    return b1;
+    rebuild(std::move(bbs), idoms);
+
+#ifdef VERIFY_DOM
+    assert(verify());
+#endif
 }
 
-void Dominator::create_dominance_frontier(Function *f) {
-    for (auto &bb_r : f->bbs()) {
-        auto bb = &bb_r;
-        if (bb->pre_bbs().size() >= 2) {
-            for (auto p : bb->pre_bbs()) {
-                auto runner = p;
-                while (runner != _idom[bb]) {
-                    assert(runner);
-                    _result.dom_frontier[runner].insert(bb);
-                    runner = _idom[runner];
-                }
+// the region is only right if no edge enters it from outside except at
+// `root`, the callers are trusted but new edges are checked here anyway
+BasicBlock *DomTree::widen(BasicBlock *root,
+                           const vector<BasicBlock *> &region) const {
+    auto r = number(root);
+    auto outside = [&](BasicBlock *bb) {
+        auto it = _number.find(bb);
+        return it != _number.end() and not dominates(r, it->second);
+    };
+    auto wider = root;
+    for (auto bb : region) {
+        if (bb != root) {
+            for (auto pre : bb->pre_bbs()) {
+                if (outside(pre))
+                    wider = common_dominator(wider, pre);
             }
         }
+        // an edge leaving the region is harmless only if it was there before
+        for (auto suc : bb->suc_bbs()) {
+            if (not outside(suc))
+                continue;
+            if (contains(bb) and ::contains(_succs[number(bb)], number(suc)))
+                continue;
+            wider = common_dominator(wider, suc);
+        }
+    }
+    return wider;
+}
+
+bool DomTree::verify() const {
+    DomTree fresh;
+    fresh.build(_func);
+    if (fresh.size() != size())
+        return false;
+    for (auto bb : _bbs) {
+        if (not fresh.contains(bb) or fresh.idom(bb) != idom(bb))
+            return false;
+    }
+    return true;
+}
+
+// `idoms` is parallel to `bbs`, and an idom always goes before its children
+void DomTree::rebuild(vector<BasicBlock *> &&bbs,
+                      const vector<BasicBlock *> &idoms) {
+    _bbs = std::move(bbs);
+    assert(not _bbs.empty() and _bbs.front() == _func->get_entry_bb());
+    auto n = _bbs.size();
+
+    _number.clear();
+    for (Index i = 0; i < n; ++i) {
+        _number[_bbs[i]] = i;
+    }
+
+    _idom.assign(n, 0);
+    for (Index i = 1; i < n; ++i) {
+        _idom[i] = _number.at(idoms[i]);
+        assert(_idom[i] < i);
+    }
+
+    // dense cfg, edges from/to bbs out of the tree (unreachable) are dropped
+    _succs.assign(n, {});
+    _preds.assign(n, {});
+    for (Index i = 0; i < n; ++i) {
+        for (auto suc : _bbs[i]->suc_bbs()) {
+            auto it = _number.find(suc);
+            if (it == _number.end())
+                continue;
+            _succs[i].push_back(it->second);
+            _preds[it->second].push_back(i);
+        }
+    }
+
+    compute_tree();
+    _frontier_valid = false;
+}
+
+DomTree::Index DomTree::intersect(Index a, Index b) const {
+    while (a != b) {
+        if (_level[a] >= _level[b])
+            a = _idom[a];
+        else
+            b = _idom[b];
     }
+    return a;
 }
 
-void Dominator::create_dom_tree_succ(Function *f) {
-    for (auto &bb_r : f->bbs()) {
-        auto bb = &bb_r;
-        auto idom = _idom[bb];
-        if (idom != bb) {
-            _result.dom_tree_succ_blocks[idom].insert(bb);
+void DomTree::compute_tree() {
+    auto n = _bbs.size();
+    vector<vector<Index>> children(n);
+    _children.assign(n, {});
+    _level.assign(n, 0);
+    // parents go first, so that children are sorted by number
+    for (Index i = 1; i < n; ++i) {
+        children[_idom[i]].push_back(i);
+        _children[_idom[i]].push_back(_bbs[i]);
+        _level[i] = _level[_idom[i]] + 1;
+    }
+
+    // dfs numbering on the dominator tree
+    _dfs_in.assign(n, 0);
+    _dfs_out.assign(n, 0);
+    unsigned clock{0};
+    vector<pair<Index, size_t>> stack{{0, 0}};
+    _dfs_in[0] = clock++;
+    while (not stack.empty()) {
+        auto &[node, next_child] = stack.back();
+        if (next_child < children[node].size()) {
+            auto child = children[node][next_child++];
+            _dfs_in[child] = clock++;
+            stack.push_back({child, 0});
+        } else {
+            _dfs_out[node] = clock++;
+            stack.pop_back();
         }
     }
 }
 
-bool Dominator::ResultType::is_dom(BasicBlock *domer, BasicBlock *domee) const {
-    if (domer == domee) {
-        return true;
+void DomTree::compute_frontier() const {
+    auto n = _bbs.size();
+    vector<vector<Index>> frontier(n);
+    for (Index i = 0; i < n; ++i) {
+        if (_preds[i].size() < 2)
+            continue;
+        for (auto p : _preds[i]) {
+            auto runner = p;
+            while (runner != _idom[i]) {
+                if (frontier[runner].empty() or frontier[runner].back() != i)
+                    frontier[runner].push_back(i);
+                runner = _idom[runner];
+            }
+        }
     }
-    std::queue<BasicBlock *> bfs{};
-    bfs.push(domer);
-    while (not bfs.empty()) {
-        auto bb = bfs.front();
-        bfs.pop();
-        assert(contains(dom_tree_succ_blocks, bb));
-        for (auto &&suc_bb : dom_tree_succ_blocks.at(bb)) {
-            if (suc_bb == domee) {
-                return true;
+    _frontier.assign(n, {});
+    for (Index i = 0; i < n; ++i) {
+        for (auto df : frontier[i]) {
+            _frontier[i].push_back(_bbs[df]);
+        }
+    }
+    _frontier_valid = true;
+}
+
+BasicBlock *DomTree::common_dominator(BasicBlock *a, BasicBlock *b) const {
+    return _bbs[intersect(number(a), number(b))];
+}
+
+// A Linear Time Algorithm for Placing phi-nodes, Sreedhar and Gao
+vector<BasicBlock *>
+DomTree::iterated_frontier(const set<BasicBlock *> &bbs) const {
+    auto n = _bbs.size();
+    vector<bool> is_def(n, false), visited(n, false), in_idf(n, false);
+    // deeper nodes first
+    priority_queue<pair<unsigned, Index>> pq;
+    for (auto bb : bbs) {
+        auto it = _number.find(bb);
+        if (it == _number.end())
+            continue;
+        is_def[it->second] = true;
+        pq.push({_level[it->second], it->second});
+    }
+
+    vector<Index> idf;
+    vector<Index> worklist;
+    while (not pq.empty()) {
+        auto [root_level, root] = pq.top();
+        pq.pop();
+        // walk the dominator subtree of root, looking for J-edges that leave
+        // the subtree to a node no deeper than root
+        worklist.push_back(root);
+        visited[root] = true;
+        while (not worklist.empty()) {
+            auto node = worklist.back();
+            worklist.pop_back();
+            for (auto suc : _succs[node]) {
+                if (_idom[suc] == node and suc != 0)
+                    continue; // D-edge
+                if (_level[suc] > root_level or in_idf[suc])
+                    continue;
+                in_idf[suc] = true;
+                idf.push_back(suc);
+                if (not is_def[suc])
+                    pq.push({_level[suc], suc});
+            }
+            for (auto child : _children[node]) {
+                auto c = _number.at(child);
+                if (not visited[c]) {
+                    visited[c] = true;
+                    worklist.push_back(c);
+                }
             }
-            bfs.push(suc_bb);
         }
     }
-    return false;
+
+    sort(idf.begin(), idf.end());
+    vector<BasicBlock *> ret;
+    for (auto i : idf) {
+        ret.push_back(_bbs[i]);
+    }
+    return ret;
+}
+
+bool Dominator::ResultType::dominates(Instruction *def,
+                                      Instruction *user) const {
+    auto def_bb = def->get_parent();
+    auto user_bb = user->get_parent();
+    if (def_bb != user_bb) {
+        return dominates(def_bb, user_bb);
+    }
+    if (def == user) {
+        return false;
+    }
+    // in the same bb, phis are evaluated in parallel at the entry
+    if (is_a<PhiInst>(def) and is_a<PhiInst>(user)) {
+        return false;
+    }
+    for (auto &&inst : def_bb->insts()) {
+        if (&inst == def) {
+            return true;
+        }
+        if (&inst == user) {
+            return false;
+        }
+    }
+    throw unreachable_error{};
+}
+
+bool Dominator::ResultType::dominates(Instruction *def, const Use &use) const {
+    auto user = as_a<Instruction>(use.user);
+    if (is_a<PhiInst>(user)) {
+        auto incoming = as_a<BasicBlock>(user->get_operand(use.op_idx + 1));
+        return dominates(def->get_parent(), incoming);
+    }
+    return dominates(def, user);
 }
@@ -1,57 +1,158 @@
 #pragma once
 #include "basic_block.hh"
-#include "depth_order.hh"
 #include "function.hh"
 #include "module.hh"
 #include "pass.hh"
-#include "remove_unreach_bb.hh"
 #include <map>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 namespace pass {
+
+/* dominator tree of one function
+ *
+ * the tree is kept in dense arrays indexed by the number of each bb (entry is
+ * 0, a parent is always numbered before its children). each node also gets a
+ * DFS in/out number on the tree, so that a dominates b iff
+ *   in[a] <= in[b] and out[b] <= out[a]
+ * which makes dominance queries O(1)
+ *
+ * transform passes that edit the CFG can keep the tree up to date with
+ * insert_edge/delete_edge/apply_updates instead of killing Dominator. updates
+ * are applied after the CFG has been changed but before any bb is erased, the
+ * new idoms are only recomputed inside the dominator subtree of the nearest
+ * common dominator of the updated edges (semi-NCA style, see
+ * An Experimental Study of Dynamic Dominators, Georgiadis et al.)
+ */
+class DomTree {
+  public:
+    using Index = unsigned;
+
+    struct Update {
+        enum Kind { Insert, Delete };
+        Kind kind;
+        ir::BasicBlock *from, *to;
+    };
+
+    void build(ir::Function *f);
+    void recalculate() { build(_func); }
+
+    // edges between bbs not in the tree yet (e.g. the bbs cloned by inline)
+    // do not need to be listed, they are found by walking the CFG
+    void apply_updates(const std::vector<Update> &updates);
+    void insert_edge(ir::BasicBlock *from, ir::BasicBlock *to) {
+        apply_updates({{Update::Insert, from, to}});
+    }
+    void delete_edge(ir::BasicBlock *from, ir::BasicBlock *to) {
+        apply_updates({{Update::Delete, from, to}});
+    }
+    // compare with a tree built from scratch
+    bool verify() const;
+
+    // bbs unreachable from the entry are not in the tree
+    bool contains(ir::BasicBlock *bb) const {
+        return ::contains(_number, bb);
+    }
+    size_t size() const { return _bbs.size(); }
+    Index number(ir::BasicBlock *bb) const { return _number.at(bb); }
+    ir::BasicBlock *bb(Index i) const { return _bbs[i]; }
+    ir::BasicBlock *root() const { return _bbs.front(); }
+
+    // the idom of the root is nullptr
+    ir::BasicBlock *idom(ir::BasicBlock *bb) const {
+        auto i = number(bb);
+        return i == 0 ? nullptr : _bbs[_idom[i]];
+    }
+    unsigned level(ir::BasicBlock *bb) const { return _level[number(bb)]; }
+    // children on the dominator tree, in the order of their numbers
+    const std::vector<ir::BasicBlock *> &children(ir::BasicBlock *bb) const {
+        return _children[number(bb)];
+    }
+    // computed lazily, and again after the tree is updated
+    const std::vector<ir::BasicBlock *> &frontier(ir::BasicBlock *bb) const {
+        if (not _frontier_valid)
+            compute_frontier();
+        return _frontier[number(bb)];
+    }
+
+    bool dominates(ir::BasicBlock *a, ir::BasicBlock *b) const {
+        return dominates(number(a), number(b));
+    }
+    bool strictly_dominates(ir::BasicBlock *a, ir::BasicBlock *b) const {
+        return a != b and dominates(a, b);
+    }
+    // nearest common dominator
+    ir::BasicBlock *common_dominator(ir::BasicBlock *a,
+                                     ir::BasicBlock *b) const;
+
+    // the union of iterated dominance frontiers of `bbs`, i.e. where the phis
+    // for a variable defined in `bbs` should be placed, sorted by number
+    std::vector<ir::BasicBlock *>
+    iterated_frontier(const std::set<ir::BasicBlock *> &bbs) const;
+
+  private:
+    ir::Function *_func{nullptr};
+    std::vector<ir::BasicBlock *> _bbs;
+    std::unordered_map<ir::BasicBlock *, Index> _number;
+    std::vector<std::vector<Index>> _succs, _preds;
+    std::vector<Index> _idom;
+    std::vector<unsigned> _level, _dfs_in, _dfs_out;
+    std::vector<std::vector<ir::BasicBlock *>> _children;
+    mutable std::vector<std::vector<ir::BasicBlock *>> _frontier;
+    mutable bool _frontier_valid{false};
+
+    bool dominates(Index a, Index b) const {
+        return _dfs_in[a] <= _dfs_in[b] and _dfs_out[b] <= _dfs_out[a];
+    }
+    Index intersect(Index a, Index b) const;
+    ir::BasicBlock *widen(ir::BasicBlock *root,
+                          const std::vector<ir::BasicBlock *> &region) const;
+    void rebuild(std::vector<ir::BasicBlock *> &&bbs,
+                 const std::vector<ir::BasicBlock *> &idoms);
+    void compute_tree();
+    void compute_frontier() const;
+};
+
 class Dominator final : public pass::AnalysisPass {
   public:
     explicit Dominator() {}
     ~Dominator() = default;
 
     struct ResultType {
-        std::map<ir::BasicBlock *, std::set<ir::BasicBlock *>> dom_frontier;
-        std::map<ir::BasicBlock *, std::set<ir::BasicBlock *>>
-            dom_tree_succ_blocks;
-        bool is_dom(ir::BasicBlock *domer, ir::BasicBlock *domee) const;
+        std::unordered_map<ir::Function *, DomTree> dom_tree;
+
+        const DomTree &at(ir::Function *f) const { return dom_tree.at(f); }
+        DomTree &at(ir::Function *f) { return dom_tree.at(f); }
+
+        bool dominates(ir::BasicBlock *domer, ir::BasicBlock *domee) const {
+            return at(domer->get_func()).dominates(domer, domee);
+        }
+        // `def` dominates `user` if `user` is only reached after `def`
+        bool dominates(ir::Instruction *def, ir::Instruction *user) const;
+        // for phi, the use happens at the end of the incoming bb
+        bool dominates(ir::Instruction *def, const ir::Use &use) const;
+
+        const std::vector<ir::BasicBlock *> &
+        dom_tree_succ_blocks(ir::BasicBlock *bb) const {
+            return at(bb->get_func()).children(bb);
+        }
+        const std::vector<ir::BasicBlock *> &
+        dom_frontier(ir::BasicBlock *bb) const {
+            return at(bb->get_func()).frontier(bb);
+        }
     };
 
-    virtual void get_analysis_usage(pass::AnalysisUsage &AU) const override {
-        using KillType = pass::AnalysisUsage::KillType;
-        AU.set_kill_type(KillType::None);
-        AU.add_require<RmUnreachBB>();
-        AU.add_require<DepthOrder>();
-    }
+    // defined in dominator.cc, as RmUnreachBB preserves Dominator
+    virtual void get_analysis_usage(pass::AnalysisUsage &AU) const override;
 
     virtual bool run(pass::PassManager *mgr) override;
 
     virtual std::any get_result() const override { return &_result; }
 
-    virtual void clear() override {
-        _result.dom_frontier.clear();
-        _result.dom_tree_succ_blocks.clear();
-        _idom.clear();
-        _depth_order = nullptr;
-        f = nullptr;
-    }
+    virtual void clear() override { _result.dom_tree.clear(); }
 
   private:
     ResultType _result;
-
-    const pass::DepthOrder::ResultType *_depth_order;
-
-    ir::Function *f;
-
-    std::map<ir::BasicBlock *, ir::BasicBlock *> _idom{};
-
-    ir::BasicBlock *intersect(ir::BasicBlock *b1, ir::BasicBlock *b2);
-    void create_idom(ir::Function *f);
-    void create_dominance_frontier(ir::Function *f);
-    void create_dom_tree_succ(ir::Function *f);
 };
 } // namespace pass
@@ -4,6 +4,7 @@
 #include "instruction.hh"
 #include "type.hh"
 #include "utils.hh"
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -13,82 +14,100 @@ using namespace std;
 
 bool FuncInfo::run(PassManager *mgr) {
     clear();
-    auto m = mgr->get_module();
-    // calculate the pure function
-    for (auto &f_r : m->functions()) {
-        // init
-        if (_result.callers.find(&f_r) == _result.callers.end())
-            _result.callers[&f_r] = {};
-        for (auto &bb_r : f_r.bbs()) {
-            for (auto &inst_r : bb_r.insts()) {
-                auto inst = &inst_r;
-                if (is_a<CallInst>(inst)) {
-                    _result.callers[as_a<Function>(inst->operands()[0])].insert(
-                        &f_r);
-                }
+    auto &call_graph = mgr->get_result<CallGraph>();
+    // bottom up, so the callees out of an scc are done, while the functions
+    // in a recursive scc are merged with each other until nothing changes
+    for (auto &scc : call_graph.sccs()) {
+        for (auto f : scc)
+            collect_local(f, _result.summaries[f]);
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto f : scc) {
+                for (auto call : call_graph.call_sites(f))
+                    changed |= merge_call(call, _result.summaries.at(f));
             }
         }
-    }
-    // calculate the probable pure func
-    for (auto &f_r : m->functions()) {
-        auto f = &f_r;
-        if (maybe_pure(f)) {
-            _result.pure_functions.insert(f);
-        }
-    }
-    // iterate to delete functions that call impure funcion
-    while (not callee_pure.empty()) {
-        auto callee = callee_pure.front();
-        callee_pure.pop_front();
-        if (_result.is_pure_function(callee))
-            continue;
-        for (auto caller : _result.callers.at(callee)) {
-            if (_result.is_pure_function(caller)) {
-                _result.pure_functions.erase(caller);
-                callee_pure.push_back(caller);
-            }
+        for (auto f : scc) {
+            auto &summary = _result.summaries.at(f);
+            if (not summary.io and not summary.may_ref() and
+                not summary.may_mod() and f->get_name() != "main")
+                _result.pure_functions.insert(f);
         }
     }
     return false;
 }
 
-bool FuncInfo::maybe_pure(Function *func) {
-    if (func->is_external or func->get_name() == "main")
-        return false;
+// the accesses in func itself, an external function may read or write
+// through all its pointer arguments
+void FuncInfo::collect_local(Function *func, ModRefSummary &summary) {
+    if (func->is_external) {
+        summary.io = true;
+        auto &args = func->get_args();
+        for (unsigned i = 0; i < args.size(); ++i) {
+            if (not args[i]->get_type()->is<PointerType>())
+                continue;
+            summary.ref_args.insert(i);
+            summary.mod_args.insert(i);
+        }
+        return;
+    }
     for (auto &bb : func->bbs()) {
         for (auto &inst : bb.insts()) {
-            if (is_side_effect_inst(&inst)) {
-                return false;
-            }
+            if (is_a<LoadInst>(&inst))
+                record(inst.get_operand(0), false, summary);
+            else if (is_a<StoreInst>(&inst))
+                record(inst.get_operand(1), true, summary);
         }
     }
-    return true;
 }
 
-// This can only focus on part around it the inst may not be a side-effect inst
-// before mem2reg & DCE
-bool FuncInfo::is_side_effect_inst(Instruction *inst) {
-    Value *addr = nullptr;
-    if (is_a<LoadInst>(inst)) { // it can lead to a different return value for
-                                // the same params
-        addr = get_origin_addr(inst->get_operand(0));
-    } else if (is_a<StoreInst>(inst)) { // it can change non-local
-                                        // variables(globalvar,argument)
-        addr = get_origin_addr(inst->get_operand(1));
-    } else if (is_a<CallInst>(
-                   inst)) { // it can result the same thing as the two above
-        // deal with it after excluding most impure function
-        auto callee = as_a<Function>(inst->operands()[0]);
-        if (not contains(callee_pure, callee))
-            callee_pure.push_back(callee);
-        return false;
-    } else {
+// what the callee does through the pointers passed to it is done to the
+// objects they point to in the caller
+bool FuncInfo::merge_call(CallInst *call, ModRefSummary &summary) {
+    auto callee = as_a<Function>(call->get_operand(0));
+    auto &callee_summary = _result.summaries.at(callee);
+    bool changed = false;
+    auto merge = [&](auto &dst, auto &src) {
+        for (auto v : src)
+            changed |= dst.insert(v).second;
+    };
+    merge(summary.ref_globals, callee_summary.ref_globals);
+    merge(summary.mod_globals, callee_summary.mod_globals);
+    for (auto i : callee_summary.ref_args)
+        changed |= record(call->get_operand(i + 1), false, summary);
+    for (auto i : callee_summary.mod_args)
+        changed |= record(call->get_operand(i + 1), true, summary);
+    auto merge_bit = [&](bool &dst, bool src) {
+        changed |= src and not dst;
+        dst |= src;
+    };
+    merge_bit(summary.ref_unknown, callee_summary.ref_unknown);
+    merge_bit(summary.mod_unknown, callee_summary.mod_unknown);
+    merge_bit(summary.io, callee_summary.io);
+    return changed;
+}
+
+bool FuncInfo::record(Value *addr, bool is_mod, ModRefSummary &summary) {
+    auto origin = get_origin_addr(addr);
+    if (origin and is_a<AllocaInst>(origin))
         return false;
+    if (origin and is_a<GlobalVariable>(origin)) {
+        auto &globals = is_mod ? summary.mod_globals : summary.ref_globals;
+        return globals.insert(as_a<GlobalVariable>(origin)).second;
     }
-    if (addr and is_a<AllocaInst>(addr))
-        return false;
-    else
-        return true;
+    if (origin and is_a<Argument>(origin)) {
+        auto arg = as_a<Argument>(origin);
+        auto &args = arg->get_function()->get_args();
+        unsigned idx = find(args.begin(), args.end(), arg) - args.begin();
+        assert(idx < args.size());
+        auto &indices = is_mod ? summary.mod_args : summary.ref_args;
+        return indices.insert(idx).second;
+    }
+    auto &unknown = is_mod ? summary.mod_unknown : summary.ref_unknown;
+    bool changed = not unknown;
+    unknown = true;
+    return changed;
 }
 
 // address may be local, global, argument
@@ -1,12 +1,37 @@
 #pragma once
+#include "call_graph.hh"
 #include "function.hh"
+#include "global_variable.hh"
 #include "instruction.hh"
 #include "pass.hh"
 #include "utils.hh"
-#include <deque>
 #include <set>
+#include <unordered_map>
 
 namespace pass {
+
+/* the memory a function may read or write, including through its callees,
+ * other than its own allocas
+ *
+ * an argument is recorded by its index, so that a call site can map it to
+ * the pointer passed in. a pointer made by int2ptr is not traced back, and
+ * counts as unknown
+ */
+struct ModRefSummary {
+    std::set<ir::GlobalVariable *> ref_globals, mod_globals;
+    std::set<unsigned> ref_args, mod_args;
+    bool ref_unknown{false}, mod_unknown{false};
+    // calls an external function, i.e. does I/O
+    bool io{false};
+
+    bool may_ref() const {
+        return ref_unknown or not ref_globals.empty() or not ref_args.empty();
+    }
+    bool may_mod() const {
+        return mod_unknown or not mod_globals.empty() or not mod_args.empty();
+    }
+};
+
 class FuncInfo final : public pass::AnalysisPass {
   public:
     explicit FuncInfo() {}
@@ -14,16 +39,27 @@ class FuncInfo final : public pass::AnalysisPass {
 
     struct ResultType {
         std::set<ir::Function *> pure_functions{};
-        std::map<ir::Function *, std::set<ir::Function *>> callers{};
+        std::unordered_map<ir::Function *, ModRefSummary> summaries{};
 
+        // touches nothing but its own allocas, so that two calls with the
+        // same arguments give the same result
         bool is_pure_function(ir::Function *inst) const {
             return contains(pure_functions, inst);
         }
+        // a call to it can be removed if the result is not used
+        bool has_side_effect(ir::Function *func) const {
+            auto &summary = summaries.at(func);
+            return summary.io or summary.may_mod();
+        }
+        const ModRefSummary &summary(ir::Function *func) const {
+            return summaries.at(func);
+        }
     };
 
     virtual void get_analysis_usage(pass::AnalysisUsage &AU) const override {
         using KillType = pass::AnalysisUsage::KillType;
         AU.set_kill_type(KillType::None);
+        AU.add_require<CallGraph>();
     }
 
     virtual std::any get_result() const override { return &_result; }
@@ -32,17 +68,16 @@ class FuncInfo final : public pass::AnalysisPass {
 
     virtual void clear() override {
         _result.pure_functions.clear();
-        _result.callers.clear();
-        callee_pure.clear();
+        _result.summaries.clear();
     }
 
   private:
-    bool maybe_pure(ir::Function *func);
-    bool is_side_effect_inst(ir::Instruction *inst);
+    void collect_local(ir::Function *func, ModRefSummary &summary);
+    bool merge_call(ir::CallInst *call, ModRefSummary &summary);
+    // returns whether anything new is recorded
+    bool record(ir::Value *addr, bool is_mod, ModRefSummary &summary);
     ir::Value *get_origin_addr(ir::Value *addr);
 
     ResultType _result;
-
-    std::deque<ir::Function *> callee_pure;
 };
 } // namespace pass
@@ -5,6 +5,8 @@
 #include "instruction.hh"
 #include "log.hh"
 #include "utils.hh"
+#include <algorithm>
+#include <functional>
 #include <queue>
 #include <sys/types.h>
 #include <unordered_map>
@@ -30,7 +32,7 @@ bool LoopFind::run(PassManager *mgr) {
         for (auto &&bb : func.bbs()) {
             // try find a loop using bb as header
             for (auto &&pre_bb : bb.pre_bbs()) {
-                if (_dom->is_dom(&bb, pre_bb)) {
+                if (_dom->dominates(&bb, pre_bb)) {
                     // found a latch pre_bb -> bb
                     if (not contains(loops, &bb)) {
                         // first time to find the header bb
@@ -65,6 +67,10 @@ bool LoopFind::run(PassManager *mgr) {
                 for (auto bb : loop.bbs) {
                     for (auto suc : bb->suc_bbs()) {
                         if (not contains(loop.bbs, suc)) {
+                            if (not contains(loop.exits, bb)) {
+                                loop.exitings.push_back(bb);
+                            }
+                            loop.exit_edges.push_back({bb, suc});
                             loop.exits.insert({bb, nullptr});
                             if (suc->pre_bbs().size() == 1) {
                                 loop.exits[bb] = suc;
@@ -72,22 +78,11 @@ bool LoopFind::run(PassManager *mgr) {
                         }
                     }
                 }
-
-                // set sub loop
-                for (auto &&[other_header, other_loop] : loops) {
-                    if (other_header == &bb) {
-                        continue;
-                    }
-                    if (contains(other_loop.bbs, &bb)) {
-                        other_loop.sub_loops.insert(&bb);
-                    }
-                }
-
-                // parse ind var
-                loop.ind_var_info = parse_ind_var(&bb, loop);
             }
         }
-        _result.loop_info[&func].loops = std::move(loops);
+        auto &info = _result.loop_info[&func];
+        info.loops = std::move(loops);
+        build_forest(&func, info);
     }
     // log();
     return false;
@@ -116,148 +111,60 @@ set<BasicBlock *> LoopFind::find_bbs_by_latch(BasicBlock *header,
     return ret;
 }
 
-auto LoopFind::parse_ind_var(BasicBlock *header, const LoopInfo &loop)
-    -> optional<LoopInfo::IndVarInfo> {
-
-    LoopInfo::IndVarInfo ind_var_info;
+void LoopFind::build_forest(Function *func, ResultType::FuncLoopInfo &info) {
+    auto &loops = info.loops;
 
-    if (loop.latches.size() > 1) {
-        return nullopt;
-    }
-
-    // the loop has too many exiting edges
-    if (loop.exits.size() > 1) {
-        return nullopt;
-    }
-
-    // the exiting bb is not header
-    auto exiting = loop.exits.begin()->first;
-    if (exiting != header) {
-        return nullopt;
-    }
-
-    // induction var
-    auto br_inst = header->insts().back().as<BrInst>();
-    assert(br_inst->operands().size() == 3);
-    auto cond = br_inst->get_operand(0);
-    // the induction variable should be of int type
-    if (not cond->is<ICmpInst>()) {
-        return nullopt;
+    // the loops containing a bb are nested in each other, so the innermost
+    // one is the last to visit if the larger loops are visited first
+    vector<BasicBlock *> headers;
+    for (auto &bb : func->bbs()) {
+        if (contains(loops, &bb)) {
+            headers.push_back(&bb);
+        }
     }
-
-    auto icmp_inst = cond->as<ICmpInst>();
-    auto icmp_op = icmp_inst->get_icmp_op();
-    auto lhs = icmp_inst->lhs();
-    auto rhs = icmp_inst->rhs();
-
-    auto exit_cond = [&](bool is_ind_rhs) {
-        auto opposite = ICmpInst::opposite_icmp_op(icmp_op);
-        auto op = is_ind_rhs ? opposite : icmp_op;
-        if (not contains(loop.bbs, br_inst->get_operand(2)->as<BasicBlock>())) {
-            // exit if cond is true
-            return op;
-        } else if (not contains(loop.bbs,
-                                br_inst->get_operand(1)->as<BasicBlock>())) {
-            // exit if cond is false
-            return ICmpInst::not_icmp_op(op);
-        } else {
-            throw unreachable_error{};
+    stable_sort(headers.begin(), headers.end(),
+                [&](BasicBlock *lhs, BasicBlock *rhs) {
+                    return loops.at(lhs).bbs.size() > loops.at(rhs).bbs.size();
+                });
+    for (auto header : headers) {
+        auto &loop = loops.at(header);
+        loop.header = header;
+        loop.depth = 1;
+        if (contains(info.innermost, header)) {
+            loop.parent = info.innermost.at(header);
+            loop.depth = loops.at(loop.parent).depth + 1;
         }
-    };
-
-    auto is_loop_invariant = [&](Value *v) {
-        if (not v->is<Instruction>()) {
-            return true;
+        for (auto bb : loop.bbs) {
+            info.innermost[bb] = header;
         }
-        auto inst = as_a<Instruction>(v);
-        return not contains(loop.bbs, inst->get_parent());
-    };
-
-    if (is_loop_invariant(lhs)) {
-        ind_var_info.ind_var = rhs;
-        ind_var_info.icmp_op = exit_cond(true);
-        ind_var_info.bound = lhs;
-    } else if (is_loop_invariant(rhs)) {
-        ind_var_info.ind_var = lhs;
-        ind_var_info.icmp_op = exit_cond(false);
-        ind_var_info.bound = rhs;
-    } else {
-        return nullopt;
     }
 
-    // find initial and step
-    ind_var_info.initial = nullptr;
-    ind_var_info.step = nullptr;
-    for (auto &&inst : header->insts()) {
-        if (not inst.is<PhiInst>()) {
-            break;
-        }
-        if (&inst != ind_var_info.ind_var) {
+    // keep the sub loops in the order of the bbs
+    for (auto &bb : func->bbs()) {
+        if (not contains(loops, &bb)) {
             continue;
         }
-        // the phi for induction variable
-        auto phi_inst = inst.as<PhiInst>();
-        // the phi should has two source, one from preheader and the other from
-        // loop body
-        if (phi_inst->to_pairs().size() != 2) {
-            return nullopt;
-        }
-        for (auto [value, source] : phi_inst->to_pairs()) {
-            if (contains(loop.bbs, source)) {
-                // step
-                if (not value->is<IBinaryInst>()) {
-                    continue;
-                }
-                auto ibinary_inst = value->as<IBinaryInst>();
-                auto ibin_op = ibinary_inst->get_ibin_op();
-                if (ibin_op != IBinaryInst::ADD) {
-                    continue;
-                }
-                if (ibinary_inst->rhs() == ind_var_info.ind_var) {
-                    ind_var_info.step = ibinary_inst->lhs();
-                } else if (ibinary_inst->lhs() == ind_var_info.ind_var) {
-                    ind_var_info.step = ibinary_inst->rhs();
-                }
-            } else {
-                // initial
-                ind_var_info.initial = value;
-            }
+        auto parent = loops.at(&bb).parent;
+        if (parent == nullptr) {
+            info.roots.push_back(&bb);
+        } else {
+            loops.at(parent).sub_loops.push_back(&bb);
         }
     }
-    if (ind_var_info.initial == nullptr or ind_var_info.step == nullptr) {
-        return nullopt;
-    }
-    return ind_var_info;
-}
 
-vector<BasicBlock *>
-LoopFind::ResultType::FuncLoopInfo::get_topo_order() const {
-    vector<BasicBlock *> ret;
-    map<BasicBlock *, size_t> parent_cnt;
-    for (auto &&[header, _] : loops) {
-        parent_cnt[header] = 0;
-    }
-    for (auto &&[_, loop] : loops) {
-        for (auto sub_header : loop.sub_loops) {
-            parent_cnt[sub_header]++;
+    function<void(BasicBlock *)> visit = [&](BasicBlock *header) {
+        auto &loop = loops.at(header);
+        loop.pre = info.preorder.size();
+        info.preorder.push_back(header);
+        for (auto sub : loop.sub_loops) {
+            visit(sub);
         }
+        loop.size = info.preorder.size() - loop.pre;
+        info.postorder.push_back(header);
+    };
+    for (auto root : info.roots) {
+        visit(root);
     }
-    while (not parent_cnt.empty()) {
-        bool changed{false};
-        for (auto &&[header, cnt] : parent_cnt) {
-            if (cnt == 0) {
-                ret.push_back(header);
-                for (auto sub_header : loops.at(header).sub_loops) {
-                    parent_cnt[sub_header]--;
-                }
-                parent_cnt.erase(header);
-                changed = true;
-                break;
-            }
-        }
-        assert(changed);
-    }
-    return ret;
 }
 
 void LoopFind::log() const {
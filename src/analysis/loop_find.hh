@@ -4,28 +4,73 @@
 #include "dominator.hh"
 #include <optional>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace pass {
 
+/* the loops of each function as a forest, a loop is identified by its header
+ *
+ * the loops are numbered in preorder, so that the loops nested in a loop are
+ * the ones numbered in [pre, pre + size). with the innermost loop of each bb,
+ * whether a bb is in a loop is known in constant time
+ */
 class LoopFind final : public AnalysisPass {
   public:
     struct ResultType {
         struct LoopInfo {
+            ir::BasicBlock *header;
             std::vector<ir::BasicBlock *> latches;
             std::set<ir::BasicBlock *> bbs;
             ir::BasicBlock *preheader;
+            // (exiting, exit), the exit is nullptr if it has other pre_bbs
             std::map<ir::BasicBlock *, ir::BasicBlock *> exits;
-            std::set<ir::BasicBlock *> sub_loops;
-            struct IndVarInfo {
-                ir::Value *ind_var, *initial, *step, *bound;
-                ir::ICmpInst::ICmpOp icmp_op;
-            };
-            std::optional<IndVarInfo> ind_var_info{std::nullopt};
+            // every bb with an edge out of the loop, and all such edges
+            std::vector<ir::BasicBlock *> exitings;
+            std::vector<std::pair<ir::BasicBlock *, ir::BasicBlock *>>
+                exit_edges;
+            // the headers of the loops directly nested in it
+            std::vector<ir::BasicBlock *> sub_loops;
+            // nullptr for an outermost loop
+            ir::BasicBlock *parent{nullptr};
+            // 1 for an outermost loop
+            unsigned depth{0};
+            // the preorder number, and the number of loops in its subtree
+            unsigned pre{0}, size{0};
         };
         struct FuncLoopInfo {
             std::unordered_map<ir::BasicBlock *, LoopInfo> loops;
-            std::vector<ir::BasicBlock *> get_topo_order() const;
+            // the headers of the outermost loops, in the order of the bbs
+            std::vector<ir::BasicBlock *> roots;
+            // headers, a loop comes before (or after) the loops nested in it
+            std::vector<ir::BasicBlock *> preorder, postorder;
+            // bb -> header of the innermost loop containing it
+            std::unordered_map<ir::BasicBlock *, ir::BasicBlock *> innermost;
+
+            // nullptr if bb is not in any loop
+            const LoopInfo *loop_of(ir::BasicBlock *bb) const {
+                auto it = innermost.find(bb);
+                return it == innermost.end() ? nullptr
+                                             : &loops.at(it->second);
+            }
+            // the number of loops containing bb
+            unsigned depth_of(ir::BasicBlock *bb) const {
+                auto loop = loop_of(bb);
+                return loop ? loop->depth : 0;
+            }
+            bool is_header(ir::BasicBlock *bb) const {
+                return loops.find(bb) != loops.end();
+            }
+            // whether bb is in the loop of header
+            bool in_loop(ir::BasicBlock *bb, ir::BasicBlock *header) const {
+                auto inner = loop_of(bb);
+                return inner and nested_in(inner->header, header);
+            }
+            // whether the loop of inner is (or is nested in) the one of outer
+            bool nested_in(ir::BasicBlock *inner, ir::BasicBlock *outer) const {
+                auto &i = loops.at(inner), &o = loops.at(outer);
+                return o.pre <= i.pre and i.pre < o.pre + o.size;
+            }
         };
         // ((func, ((header, loop_info)...))...)
         std::unordered_map<ir::Function *, FuncLoopInfo> loop_info;
@@ -52,8 +97,7 @@ class LoopFind final : public AnalysisPass {
 
     std::set<ir::BasicBlock *> find_bbs_by_latch(ir::BasicBlock *header,
                                                  ir::BasicBlock *latch);
-    auto parse_ind_var(ir::BasicBlock *header, const LoopInfo &loop)
-        -> std::optional<LoopInfo::IndVarInfo>;
+    void build_forest(ir::Function *func, ResultType::FuncLoopInfo &info);
     void log() const;
 
     ResultType _result;
@@ -0,0 +1,170 @@
+#include "memory_ssa.hh"
+#include "instruction.hh"
+#include "utils.hh"
+#include <algorithm>
+#include <cassert>
+#include <set>
+
+using namespace pass;
+using namespace ir;
+using namespace std;
+
+bool MemorySSA::run(PassManager *mgr) {
+    clear();
+    _func_info = &mgr->get_result<FuncInfo>();
+    _result._alias = &mgr->get_result<AliasAnalysis>();
+    auto &dom = mgr->get_result<Dominator>();
+    _result._dom = &dom;
+    auto m = mgr->get_module();
+    for (auto &f_r : m->functions()) {
+        auto f = &f_r;
+        if (f->is_external)
+            continue;
+        build(f, dom.at(f));
+    }
+    return false;
+}
+
+void MemorySSA::build(Function *f, const DomTree &dom) {
+    auto n = dom.size();
+    auto entry = dom.root();
+    auto live_on_entry = _result.create(MemoryAccess::LiveOnEntry, entry);
+    _result._live_on_entry[f] = live_on_entry;
+
+    // the accesses in each bb, indexed by the number on the dominator tree
+    vector<vector<MemoryAccess *>> accesses(n);
+    set<BasicBlock *> def_bbs;
+    for (DomTree::Index i = 0; i < n; ++i) {
+        auto bb = dom.bb(i);
+        for (auto &inst_r : bb->insts()) {
+            auto inst = &inst_r;
+            MemoryAccess *acc = nullptr;
+            if (inst->is<LoadInst>()) {
+                acc = _result.create(MemoryAccess::Use, bb, inst);
+            } else if (inst->is<StoreInst>() or
+                       (inst->is<CallInst>() and
+                        _func_info
+                            ->summary(inst->get_operand(0)->as<Function>())
+                            .may_mod())) {
+                acc = _result.create(MemoryAccess::Def, bb, inst);
+                def_bbs.insert(bb);
+            }
+            if (acc)
+                accesses[i].push_back(acc);
+        }
+    }
+
+    auto phi_bbs = dom.iterated_frontier(def_bbs);
+    for (auto bb : phi_bbs) {
+        _result._phi[bb] = _result.create(MemoryAccess::Phi, bb);
+    }
+
+    // rename, the state at the entry of a bb is the one at the end of its idom
+    // unless there is a phi, and a parent is always numbered before its
+    // children
+    vector<const MemoryAccess *> out(n, nullptr);
+    for (DomTree::Index i = 0; i < n; ++i) {
+        auto bb = dom.bb(i);
+        const MemoryAccess *cur =
+            i == 0 ? live_on_entry : out[dom.number(dom.idom(bb))];
+        if (auto phi = _result.get_phi(bb))
+            cur = phi;
+        for (auto acc : accesses[i]) {
+            acc->defining = cur;
+            if (acc->is_def())
+                cur = acc;
+        }
+        out[i] = cur;
+    }
+
+    for (auto bb : phi_bbs) {
+        auto phi = _result._phi.at(bb);
+        if (bb == entry)
+            phi->incomings.push_back({nullptr, live_on_entry});
+        for (auto pre : bb->pre_bbs()) {
+            if (dom.contains(pre))
+                phi->incomings.push_back({pre, out[dom.number(pre)]});
+        }
+    }
+}
+
+using ResultType = MemorySSA::ResultType;
+
+MemoryAccess *ResultType::create(MemoryAccess::Kind kind, BasicBlock *bb,
+                                 Instruction *inst) {
+    _pool.push_back(make_unique<MemoryAccess>(kind, bb, inst));
+    auto acc = _pool.back().get();
+    if (inst)
+        _access[inst] = acc;
+    return acc;
+}
+
+const MemoryAccess *ResultType::get_clobbering_access(LoadInst *load) const {
+    auto it = _clobber.find(load);
+    if (it != _clobber.end())
+        return it->second;
+    auto use = get_access(load);
+    if (use == nullptr)
+        return _clobber[load] = nullptr;
+    unordered_map<const MemoryAccess *, const MemoryAccess *> phi_clobber;
+    auto loc = AliasAnalysis::ResultType::location(load->ptr());
+    return _clobber[load] = walk(use->defining, loc, phi_clobber);
+}
+
+/* the values in loc are defined before the phi, so they are not redefined
+ * when going around a loop through the phi
+ */
+bool ResultType::is_fixed_at(const MemLoc &loc,
+                             const MemoryAccess *phi) const {
+    auto fixed = [&](Value *v) {
+        if (not v->is<Instruction>() or v->is<AllocaInst>())
+            return true;
+        auto bb = v->as<Instruction>()->get_parent();
+        return _dom->at(bb->get_func()).strictly_dominates(bb, phi->bb);
+    };
+    return fixed(loc.base) and
+           all_of(loc.offset.terms.begin(), loc.offset.terms.end(),
+                  [&](auto &term) { return fixed(term.first); });
+}
+
+/* skip the Defs that never write to loc, and look through a Phi if all the
+ * paths into it reach the same clobber
+ *
+ * a Phi being walked maps to itself in phi_clobber: an incoming that only
+ * reaches the Phi again comes around a cycle without writing to loc, so it
+ * is ignored. the result dominates the Phi as all the other incomings agree
+ */
+const MemoryAccess *ResultType::walk(
+    const MemoryAccess *start, const MemLoc &loc,
+    unordered_map<const MemoryAccess *, const MemoryAccess *> &phi_clobber)
+    const {
+    auto acc = start;
+    while (acc->kind == MemoryAccess::Def and
+           not is_mod(_alias->get_mod_ref(acc->inst, loc))) {
+        acc = acc->defining;
+    }
+    if (acc->kind != MemoryAccess::Phi)
+        return acc;
+    auto it = phi_clobber.find(acc);
+    if (it != phi_clobber.end())
+        return it->second;
+    if (not is_fixed_at(loc, acc))
+        return acc;
+
+    phi_clobber[acc] = acc;
+    const MemoryAccess *clobber = nullptr;
+    for (auto &[pre, incoming] : acc->incomings) {
+        auto c = walk(incoming, loc, phi_clobber);
+        if (c == acc)
+            continue;
+        if (clobber == nullptr) {
+            clobber = c;
+        } else if (clobber != c) {
+            clobber = acc;
+            break;
+        }
+    }
+    if (clobber == nullptr)
+        clobber = acc;
+    return phi_clobber[acc] = clobber;
+}
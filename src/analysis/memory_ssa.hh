@@ -0,0 +1,128 @@
+#pragma once
+
+#include "alias_analysis.hh"
+#include "basic_block.hh"
+#include "dominator.hh"
+#include "func_info.hh"
+#include "function.hh"
+#include "instruction.hh"
+#include "pass.hh"
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pass {
+
+/* a memory state (Def, Phi or LiveOnEntry) or a read of one (Use)
+ *
+ * Def: a store or a call that may write memory, which clobbers `defining`
+ *      and makes a new state
+ * Use: a load, which reads `defining`
+ * Phi: the merge of the states at the end of the preds of `bb`
+ * LiveOnEntry: the memory when the function is entered
+ */
+struct MemoryAccess {
+    enum Kind { LiveOnEntry, Def, Use, Phi };
+
+    Kind kind;
+    ir::BasicBlock *bb;
+    ir::Instruction *inst{nullptr}; // nullptr for Phi and LiveOnEntry
+    const MemoryAccess *defining{nullptr}; // for Def and Use
+    std::vector<std::pair<ir::BasicBlock *, const MemoryAccess *>> incomings;
+
+    MemoryAccess(Kind kind, ir::BasicBlock *bb, ir::Instruction *inst = nullptr)
+        : kind(kind), bb(bb), inst(inst) {}
+
+    bool is_def() const { return kind != Use; }
+};
+
+/* memory SSA, all memory in a function is treated as one variable, so that
+ * each load is linked to the state it reads and a store to the one it
+ * overwrites, see Memory SSA - A Unified Approach for Sparsely Representing
+ * Memory Operations, Novillo
+ *
+ * phis are placed on the iterated dominance frontier of the bbs with Defs and
+ * the accesses are renamed in the order of the dominator tree. loads in bbs
+ * unreachable from the entry have no access
+ *
+ * the defining access of a Use is not optimized when the SSA is built, call
+ * get_clobbering_access to skip the Defs (and Phis) that never write to the
+ * location of the load
+ */
+class MemorySSA final : public AnalysisPass {
+  public:
+    class ResultType {
+        friend class MemorySSA;
+
+      public:
+        // nullptr if inst does not touch memory, or is unreachable
+        const MemoryAccess *get_access(ir::Instruction *inst) const {
+            auto it = _access.find(inst);
+            return it == _access.end() ? nullptr : it->second;
+        }
+        // nullptr if there is no phi at bb
+        const MemoryAccess *get_phi(ir::BasicBlock *bb) const {
+            auto it = _phi.find(bb);
+            return it == _phi.end() ? nullptr : it->second;
+        }
+        const MemoryAccess *live_on_entry(ir::Function *f) const {
+            return _live_on_entry.at(f);
+        }
+
+        // the nearest state dominating the load that may write to its
+        // location, a Phi if the paths into it disagree on that, nullptr if
+        // the load is unreachable
+        const MemoryAccess *get_clobbering_access(ir::LoadInst *load) const;
+
+      private:
+        const AliasAnalysis::ResultType *_alias{nullptr};
+        const Dominator::ResultType *_dom{nullptr};
+        std::vector<std::unique_ptr<MemoryAccess>> _pool;
+        std::unordered_map<ir::Instruction *, MemoryAccess *> _access;
+        std::unordered_map<ir::BasicBlock *, MemoryAccess *> _phi;
+        std::unordered_map<ir::Function *, MemoryAccess *> _live_on_entry;
+        mutable std::unordered_map<ir::LoadInst *, const MemoryAccess *>
+            _clobber;
+
+        MemoryAccess *create(MemoryAccess::Kind kind, ir::BasicBlock *bb,
+                             ir::Instruction *inst = nullptr);
+        // whether loc stays the same on the paths through the phi, so that
+        // it can be compared with the Defs above the phi
+        bool is_fixed_at(const MemLoc &loc, const MemoryAccess *phi) const;
+        const MemoryAccess *
+        walk(const MemoryAccess *start, const MemLoc &loc,
+             std::unordered_map<const MemoryAccess *, const MemoryAccess *>
+                 &phi_clobber) const;
+    };
+
+    void get_analysis_usage(AnalysisUsage &AU) const final {
+        using KillType = AnalysisUsage::KillType;
+        AU.set_kill_type(KillType::None);
+        AU.add_require<FuncInfo>();
+        AU.add_require<Dominator>();
+        AU.add_require<AliasAnalysis>();
+    }
+
+    std::any get_result() const final { return &_result; }
+
+    bool run(PassManager *mgr) final;
+
+    void clear() final {
+        _result._alias = nullptr;
+        _result._dom = nullptr;
+        _result._pool.clear();
+        _result._access.clear();
+        _result._phi.clear();
+        _result._live_on_entry.clear();
+        _result._clobber.clear();
+    }
+
+  private:
+    ResultType _result;
+    const FuncInfo::ResultType *_func_info{nullptr};
+
+    void build(ir::Function *f, const DomTree &dom);
+};
+
+} // namespace pass
@@ -0,0 +1,157 @@
+#include "post_dominator.hh"
+#include "basic_block.hh"
+#include "instruction.hh"
+#include "utils.hh"
+#include <cassert>
+#include <unordered_set>
+using namespace ir;
+using namespace pass;
+using namespace std;
+
+bool PostDominator::run(PassManager *mgr) {
+    clear();
+    auto m = mgr->get_module();
+    for (auto &f_r : m->functions()) {
+        auto f = &f_r;
+        if (f->is_external)
+            continue;
+        _result.post_dom_tree[f].build(f);
+    }
+    return false;
+}
+
+void PostDomTree::build(Function *f) {
+    // reverse post order of the reversed CFG, from the virtual exit
+    vector<BasicBlock *> exits;
+    for (auto &bb_r : f->bbs()) {
+        if (bb_r.is_terminated() and is_a<RetInst>(&bb_r.insts().back()))
+            exits.push_back(&bb_r);
+    }
+    vector<BasicBlock *> post_order;
+    unordered_set<BasicBlock *> visited;
+    using PreIter = set<BasicBlock *>::const_iterator;
+    vector<pair<BasicBlock *, PreIter>> stack;
+    for (auto exit : exits) {
+        visited.insert(exit);
+        stack.push_back({exit, exit->pre_bbs().begin()});
+        while (not stack.empty()) {
+            auto &[bb, it] = stack.back();
+            if (it == bb->pre_bbs().end()) {
+                post_order.push_back(bb);
+                stack.pop_back();
+                continue;
+            }
+            auto pre = *it++;
+            if (not ::contains(visited, pre)) {
+                visited.insert(pre);
+                stack.push_back({pre, pre->pre_bbs().begin()});
+            }
+        }
+    }
+    _bbs.assign({nullptr});
+    _bbs.insert(_bbs.end(), post_order.rbegin(), post_order.rend());
+    auto n = _bbs.size();
+
+    _number.clear();
+    for (Index i = 1; i < n; ++i) {
+        _number[_bbs[i]] = i;
+    }
+
+    // a pred on the reversed CFG is a successor on the CFG
+    _preds.assign(n, {});
+    for (auto exit : exits) {
+        _preds[_number.at(exit)].push_back(0);
+    }
+    for (Index i = 1; i < n; ++i) {
+        for (auto suc : _bbs[i]->suc_bbs()) {
+            auto it = _number.find(suc);
+            if (it == _number.end())
+                continue;
+            _preds[i].push_back(it->second);
+        }
+    }
+
+    compute_idom();
+    compute_tree();
+    compute_control_deps();
+}
+
+PostDomTree::Index PostDomTree::intersect(Index a, Index b) const {
+    while (a != b) {
+        while (a > b)
+            a = _idom[a];
+        while (b > a)
+            b = _idom[b];
+    }
+    return a;
+}
+
+// A Simple, Fast Dominance Algorithm, Cooper et al.
+void PostDomTree::compute_idom() {
+    auto n = _bbs.size();
+    constexpr Index UNDEF = -1;
+    _idom.assign(n, UNDEF);
+    _idom[0] = 0;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (Index i = 1; i < n; ++i) {
+            Index new_idom = UNDEF;
+            for (auto p : _preds[i]) {
+                if (_idom[p] == UNDEF)
+                    continue;
+                new_idom = new_idom == UNDEF ? p : intersect(p, new_idom);
+            }
+            assert(new_idom != UNDEF);
+            if (_idom[i] != new_idom) {
+                _idom[i] = new_idom;
+                changed = true;
+            }
+        }
+    }
+}
+
+void PostDomTree::compute_tree() {
+    auto n = _bbs.size();
+    vector<vector<Index>> children(n);
+    for (Index i = 1; i < n; ++i) {
+        children[_idom[i]].push_back(i);
+    }
+
+    _dfs_in.assign(n, 0);
+    _dfs_out.assign(n, 0);
+    unsigned clock{0};
+    vector<pair<Index, size_t>> stack{{0, 0}};
+    _dfs_in[0] = clock++;
+    while (not stack.empty()) {
+        auto &[node, next_child] = stack.back();
+        if (next_child < children[node].size()) {
+            auto child = children[node][next_child++];
+            _dfs_in[child] = clock++;
+            stack.push_back({child, 0});
+        } else {
+            _dfs_out[node] = clock++;
+            stack.pop_back();
+        }
+    }
+}
+
+// the reverse dominance frontier, computed the same way as Dominator does
+void PostDomTree::compute_control_deps() {
+    auto n = _bbs.size();
+    _control_deps.assign(n, {});
+    for (Index i = 1; i < n; ++i) {
+        if (_preds[i].size() < 2)
+            continue;
+        for (auto p : _preds[i]) {
+            auto runner = p;
+            while (runner != _idom[i]) {
+                auto &deps = _control_deps[runner];
+                if (deps.empty() or deps.back() != _bbs[i])
+                    deps.push_back(_bbs[i]);
+                runner = _idom[runner];
+            }
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "basic_block.hh"
+#include "function.hh"
+#include "module.hh"
+#include "pass.hh"
+#include <unordered_map>
+#include <vector>
+
+namespace pass {
+
+/* post dominator tree of one function, i.e. the dominator tree of the reversed
+ * CFG rooted at a virtual exit, whose predecessors are the bbs that return
+ *
+ * bbs that never reach a return (e.g. infinite loops) are not in the tree
+ *
+ * the reverse dominance frontier of a bb is where it is control dependent on:
+ * bb is control dependent on the branch at the end of c iff bb post dominates
+ * a successor of c but does not strictly post dominate c
+ */
+class PostDomTree {
+  public:
+    using Index = unsigned;
+
+    void build(ir::Function *f);
+
+    bool contains(ir::BasicBlock *bb) const {
+        return ::contains(_number, bb);
+    }
+    // the ipdom of a returning bb is the virtual exit, which is nullptr
+    ir::BasicBlock *ipdom(ir::BasicBlock *bb) const {
+        return _bbs[_idom[number(bb)]];
+    }
+    bool post_dominates(ir::BasicBlock *a, ir::BasicBlock *b) const {
+        auto ia = number(a), ib = number(b);
+        return _dfs_in[ia] <= _dfs_in[ib] and _dfs_out[ib] <= _dfs_out[ia];
+    }
+    // the bbs whose branch decides whether bb is executed
+    const std::vector<ir::BasicBlock *> &
+    control_deps(ir::BasicBlock *bb) const {
+        return _control_deps[number(bb)];
+    }
+
+  private:
+    // _bbs[0] is the virtual exit (nullptr)
+    std::vector<ir::BasicBlock *> _bbs;
+    std::unordered_map<ir::BasicBlock *, Index> _number;
+    std::vector<std::vector<Index>> _preds; // successors in the CFG
+    std::vector<Index> _idom;
+    std::vector<unsigned> _dfs_in, _dfs_out;
+    std::vector<std::vector<ir::BasicBlock *>> _control_deps;
+
+    Index number(ir::BasicBlock *bb) const { return _number.at(bb); }
+    Index intersect(Index a, Index b) const;
+    void compute_idom();
+    void compute_tree();
+    void compute_control_deps();
+};
+
+class PostDominator final : public pass::AnalysisPass {
+  public:
+    explicit PostDominator() {}
+    ~PostDominator() = default;
+
+    struct ResultType {
+        std::unordered_map<ir::Function *, PostDomTree> post_dom_tree;
+
+        const PostDomTree &at(ir::Function *f) const {
+            return post_dom_tree.at(f);
+        }
+    };
+
+    virtual void get_analysis_usage(pass::AnalysisUsage &AU) const override {
+        using KillType = pass::AnalysisUsage::KillType;
+        AU.set_kill_type(KillType::None);
+    }
+
+    virtual bool run(pass::PassManager *mgr) override;
+
+    virtual std::any get_result() const override { return &_result; }
+
+    virtual void clear() override { _result.post_dom_tree.clear(); }
+
+  private:
+    ResultType _result;
+};
+} // namespace pass
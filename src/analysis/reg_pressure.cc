@@ -0,0 +1,224 @@
+#include "reg_pressure.hh"
+#include "type.hh"
+#include "utils.hh"
+#include <set>
+#include <utility>
+
+using namespace pass;
+using namespace ir;
+using namespace std;
+
+bool Pressure::fits() const {
+    return ints <= PressureInfo::INT_BUDGET and
+           floats <= PressureInfo::FLOAT_BUDGET;
+}
+
+bool PressureInfo::is_reg_value(Value *v) {
+    if (v->is<Argument>())
+        return true;
+    if (not v->is<Instruction>() or v->is<AllocaInst>())
+        return false;
+    return not v->get_type()->is<VoidType>();
+}
+
+Pressure PressureInfo::of(Value *v) {
+    if (not is_reg_value(v))
+        return {};
+    if (v->get_type()->is<FloatType>())
+        return {0, 1};
+    return {1, 0};
+}
+
+Pressure PressureInfo::count(const Bits &bits) const {
+    Pressure ret;
+    for (size_t i = 0; i < bits.size(); ++i) {
+        for (auto word = bits[i]; word; word &= word - 1) {
+            auto idx = i * 64 + __builtin_ctzll(word);
+            if (_is_float[idx])
+                ++ret.floats;
+            else
+                ++ret.ints;
+        }
+    }
+    return ret;
+}
+
+template <typename Visit>
+void PressureInfo::scan(BasicBlock *bb, Visit &&visit) const {
+    auto live = _live_out.at(bb);
+    auto cur = count(live);
+    auto flip = [&](Value *v, bool set) {
+        auto idx = _index.at(v);
+        auto &word = live[idx / 64];
+        auto mask = uint64_t{1} << (idx % 64);
+        if (bool(word & mask) == set)
+            return;
+        word ^= mask;
+        auto &n = _is_float[idx] ? cur.floats : cur.ints;
+        n = set ? n + 1 : n - 1;
+    };
+    for (auto it = bb->insts().rbegin(); it != bb->insts().rend(); ++it) {
+        auto inst = &*it;
+        if (inst->is<PhiInst>())
+            break;
+        if (is_reg_value(inst))
+            flip(inst, false);
+        visit(inst, cur);
+        for (auto op : inst->operands()) {
+            if (is_reg_value(op))
+                flip(op, true);
+        }
+    }
+}
+
+void PressureInfo::build(Function *func) {
+    _index.clear();
+    _is_float.clear();
+    _live_out.clear();
+    _max.clear();
+
+    auto number = [&](Value *v) {
+        if (_index.emplace(v, _is_float.size()).second)
+            _is_float.push_back(v->get_type()->is<FloatType>());
+    };
+    for (auto arg : func->get_args())
+        number(arg);
+    // the bbs in reverse post order, then the unreachable ones. liveness is
+    // backward, so it converges fast visiting them from the end
+    vector<BasicBlock *> bbs;
+    std::set<BasicBlock *> visited{func->get_entry_bb()};
+    vector<pair<BasicBlock *, std::set<BasicBlock *>::const_iterator>> stack{
+        {func->get_entry_bb(), func->get_entry_bb()->suc_bbs().begin()}};
+    while (not stack.empty()) {
+        auto &[bb, it] = stack.back();
+        if (it == bb->suc_bbs().end()) {
+            bbs.push_back(bb);
+            stack.pop_back();
+            continue;
+        }
+        auto suc = *it++;
+        if (visited.insert(suc).second)
+            stack.push_back({suc, suc->suc_bbs().begin()});
+    }
+    reverse(bbs.begin(), bbs.end());
+    for (auto &bb_r : func->bbs()) {
+        if (not contains(visited, &bb_r))
+            bbs.push_back(&bb_r);
+        for (auto &inst : bb_r.insts()) {
+            if (is_reg_value(&inst))
+                number(&inst);
+        }
+    }
+    auto words = (_is_float.size() + 63) / 64;
+    auto set = [&](Bits &bits, Value *v) {
+        auto idx = _index.at(v);
+        bits[idx / 64] |= uint64_t{1} << (idx % 64);
+    };
+    auto test = [&](const Bits &bits, Value *v) {
+        auto idx = _index.at(v);
+        return bool(bits[idx / 64] & (uint64_t{1} << (idx % 64)));
+    };
+
+    unordered_map<BasicBlock *, size_t> bb_index;
+    for (size_t i = 0; i < bbs.size(); ++i)
+        bb_index[bbs[i]] = i;
+    // the uses before any def in the bb, and the defs
+    vector<Bits> uses(bbs.size(), Bits(words)), defs(uses), live_in(uses);
+    // the incomings of the phis in the sucs, by the pred
+    vector<Bits> phi_uses(uses), live_out(uses);
+    for (size_t i = 0; i < bbs.size(); ++i) {
+        auto &use = uses[i], &def = defs[i];
+        for (auto &inst : bbs[i]->insts()) {
+            if (inst.is<PhiInst>()) {
+                for (auto [v, pre] : inst.as<PhiInst>()->to_pairs()) {
+                    if (is_reg_value(v))
+                        set(phi_uses[bb_index.at(pre)], v);
+                }
+            } else {
+                for (auto op : inst.operands()) {
+                    if (is_reg_value(op) and not test(def, op))
+                        set(use, op);
+                }
+            }
+            if (is_reg_value(&inst))
+                set(def, &inst);
+        }
+    }
+    vector<vector<size_t>> sucs(bbs.size());
+    for (size_t i = 0; i < bbs.size(); ++i) {
+        for (auto suc : bbs[i]->suc_bbs())
+            sucs[i].push_back(bb_index.at(suc));
+    }
+
+    // the sets only grow, so they are updated in place
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = bbs.size(); i-- > 0;) {
+            auto &out = live_out[i], &in = live_in[i];
+            auto &use = uses[i], &def = defs[i], &phi_use = phi_uses[i];
+            for (size_t w = 0; w < words; ++w) {
+                auto o = phi_use[w];
+                for (auto s : sucs[i])
+                    o |= live_in[s][w];
+                auto n = use[w] | (o & ~def[w]);
+                if (o != out[w] or n != in[w]) {
+                    changed = true;
+                    out[w] = o;
+                    in[w] = n;
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < bbs.size(); ++i)
+        _live_out[bbs[i]] = std::move(live_out[i]);
+
+    for (size_t i = 0; i < bbs.size(); ++i) {
+        auto bb = bbs[i];
+        // the phis and the live in are all live at the top of bb
+        auto max = count(live_in[i]);
+        for (auto &inst : bb->insts()) {
+            if (not inst.is<PhiInst>())
+                break;
+            max = max + of(&inst);
+        }
+        scan(bb, [&](Instruction *inst, const Pressure &live) {
+            max = max.max(live + of(inst));
+        });
+        _max[bb] = max;
+    }
+}
+
+Pressure PressureInfo::max() const {
+    Pressure ret;
+    for (auto &[_, p] : _max)
+        ret = ret.max(p);
+    return ret;
+}
+
+Pressure PressureInfo::live_across(Instruction *inst) const {
+    Pressure ret;
+    scan(inst->get_parent(), [&](Instruction *i, const Pressure &live) {
+        if (i == inst)
+            ret = live;
+    });
+    return ret;
+}
+
+bool RegPressure::run(PassManager *mgr) {
+    clear();
+    auto &loop_info = mgr->get_result<LoopFind>().loop_info;
+    for (auto &f_r : mgr->get_module()->functions()) {
+        if (f_r.is_external)
+            continue;
+        auto &info = _result.infos[&f_r];
+        info.build(&f_r);
+        for (auto &[header, loop] : loop_info.at(&f_r).loops) {
+            Pressure max;
+            for (auto bb : loop.bbs)
+                max = max.max(info.max_in(bb));
+            _result.loops[header] = max;
+        }
+    }
+    return false;
+}
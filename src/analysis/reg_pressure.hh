@@ -0,0 +1,107 @@
+#pragma once
+
+#include "basic_block.hh"
+#include "function.hh"
+#include "instruction.hh"
+#include "loop_find.hh"
+#include "pass.hh"
+#include "value.hh"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace pass {
+
+// the number of values held in the int and the float registers
+struct Pressure {
+    unsigned ints{0}, floats{0};
+
+    Pressure max(const Pressure &other) const {
+        return {std::max(ints, other.ints), std::max(floats, other.floats)};
+    }
+    Pressure operator+(const Pressure &other) const {
+        return {ints + other.ints, floats + other.floats};
+    }
+    // the registers of the target are enough
+    bool fits() const;
+};
+
+/* an estimate of the register pressure of one function on ssa
+ *
+ * a value is live from its def to its last use, and the incoming of a phi is
+ * used at the end of the pred. the pressure at a point is the number of the
+ * live values, those in the float registers counted apart. constants and
+ * allocas (sp + offset in codegen) take no register
+ *
+ * the values are numbered and the live sets are bitsets, as the functions
+ * after inlining have thousands of values
+ */
+class PressureInfo {
+  public:
+    // the allocatable registers in codegen are 28 int and 32 float, a few
+    // are left for the constants and the addresses that only exist in mir
+    static constexpr unsigned INT_BUDGET = 24;
+    static constexpr unsigned FLOAT_BUDGET = 28;
+
+    void build(ir::Function *func);
+
+    // the values in a register
+    static bool is_reg_value(ir::Value *v);
+    static Pressure of(ir::Value *v);
+
+    // the max pressure in bb
+    Pressure max_in(ir::BasicBlock *bb) const { return _max.at(bb); }
+    // the max pressure of the function
+    Pressure max() const;
+    // the values live across inst, not including itself
+    Pressure live_across(ir::Instruction *inst) const;
+
+  private:
+    using Bits = std::vector<uint64_t>;
+
+    std::unordered_map<ir::Value *, unsigned> _index;
+    std::vector<bool> _is_float;
+    std::unordered_map<ir::BasicBlock *, Bits> _live_out;
+    std::unordered_map<ir::BasicBlock *, Pressure> _max;
+
+    // the pressure of the values live after each inst from the end of bb,
+    // passed to visit from the last inst to the first, phis excluded
+    template <typename Visit>
+    void scan(ir::BasicBlock *bb, Visit &&visit) const;
+    Pressure count(const Bits &bits) const;
+};
+
+class RegPressure final : public AnalysisPass {
+  public:
+    struct ResultType {
+        std::unordered_map<ir::Function *, PressureInfo> infos;
+        // the max pressure in the bbs of each loop, by its header
+        std::unordered_map<ir::BasicBlock *, Pressure> loops;
+
+        const PressureInfo &at(ir::Function *f) const { return infos.at(f); }
+        Pressure loop(ir::BasicBlock *header) const {
+            return loops.at(header);
+        }
+    };
+
+    void get_analysis_usage(AnalysisUsage &AU) const final {
+        using KillType = AnalysisUsage::KillType;
+        AU.set_kill_type(KillType::None);
+        AU.add_require<LoopFind>();
+    }
+
+    std::any get_result() const final { return &_result; }
+
+    bool run(PassManager *mgr) final;
+
+    void clear() final {
+        _result.infos.clear();
+        _result.loops.clear();
+    }
+
+  private:
+    ResultType _result;
+};
+
+} // namespace pass
@@ -0,0 +1,495 @@
+#include "scalar_evolution.hh"
+#include "basic_block.hh"
+#include "constant.hh"
+#include "err.hh"
+#include "instruction.hh"
+#include "type.hh"
+#include "utils.hh"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+using namespace pass;
+using namespace ir;
+using namespace std;
+
+namespace {
+
+int wrap_add(int a, int b) {
+    return static_cast<int>(static_cast<unsigned>(a) +
+                            static_cast<unsigned>(b));
+}
+
+int wrap_mul(int a, int b) {
+    return static_cast<int>(static_cast<unsigned>(a) *
+                            static_cast<unsigned>(b));
+}
+
+/* the first k >= 0 such that (s + k * d) op b holds, counted in int64
+ *
+ * nullopt if there is no such k before the value goes out of i32
+ */
+optional<int> first_exit(int64_t s, int64_t d, int64_t b,
+                         ICmpInst::ICmpOp op) {
+    optional<int64_t> k;
+    switch (op) {
+    case ICmpInst::EQ:
+        if ((b - s) % d == 0 and (b - s) / d >= 0)
+            k = (b - s) / d;
+        break;
+    case ICmpInst::NE:
+        k = s != b ? 0 : 1;
+        break;
+    case ICmpInst::GT:
+        if (s > b)
+            k = 0;
+        else if (d > 0)
+            k = (b - s) / d + 1;
+        break;
+    case ICmpInst::GE:
+        if (s >= b)
+            k = 0;
+        else if (d > 0)
+            k = (b - s + d - 1) / d;
+        break;
+    case ICmpInst::LT:
+        if (s < b)
+            k = 0;
+        else if (d < 0)
+            k = (s - b) / -d + 1;
+        break;
+    case ICmpInst::LE:
+        if (s <= b)
+            k = 0;
+        else if (d < 0)
+            k = (s - b - d - 1) / -d;
+        break;
+    }
+    if (not k.has_value() or k.value() > INT_MAX)
+        return nullopt;
+    auto last = s + k.value() * d;
+    if (last < INT_MIN or last > INT_MAX)
+        return nullopt;
+    return k.value();
+}
+
+} // namespace
+
+LinearExpr LinearExpr::of(Value *v) {
+    if (v->is<ConstInt>())
+        return {v->as<ConstInt>()->val()};
+    LinearExpr ret;
+    ret.terms.push_back({v, 1});
+    return ret;
+}
+
+int LinearExpr::coef(Value *v) const {
+    for (auto [term, k] : terms) {
+        if (term == v)
+            return k;
+    }
+    return 0;
+}
+
+LinearExpr LinearExpr::operator+(const LinearExpr &rhs) const {
+    auto ret = *this;
+    ret.constant = wrap_add(constant, rhs.constant);
+    for (auto [v, k] : rhs.terms) {
+        auto it = find_if(ret.terms.begin(), ret.terms.end(),
+                          [&](auto &term) { return term.first == v; });
+        if (it == ret.terms.end()) {
+            ret.terms.push_back({v, k});
+        } else if ((it->second = wrap_add(it->second, k)) == 0) {
+            ret.terms.erase(it);
+        }
+    }
+    return ret;
+}
+
+LinearExpr LinearExpr::operator-(const LinearExpr &rhs) const {
+    return *this + rhs * -1;
+}
+
+LinearExpr LinearExpr::operator*(int k) const {
+    if (k == 0)
+        return {0};
+    auto ret = *this;
+    ret.constant = wrap_mul(constant, k);
+    for (auto &term : ret.terms) {
+        term.second = wrap_mul(term.second, k);
+    }
+    ret.terms.erase(remove_if(ret.terms.begin(), ret.terms.end(),
+                              [](auto &term) { return term.second == 0; }),
+                    ret.terms.end());
+    return ret;
+}
+
+bool LinearExpr::operator==(const LinearExpr &rhs) const {
+    auto diff = *this - rhs;
+    return diff.is_const() and diff.constant == 0;
+}
+
+bool ScalarEvolution::run(PassManager *mgr) {
+    clear();
+    _result._loops = &mgr->get_result<LoopFind>();
+    return false;
+}
+
+using ResultType = ScalarEvolution::ResultType;
+
+const LoopFind::ResultType::LoopInfo &
+ResultType::loop(BasicBlock *header) const {
+    return _loops->loop_info.at(header->get_func()).loops.at(header);
+}
+
+bool ResultType::in_loop(Value *v, BasicBlock *header) const {
+    return v->is<Instruction>() and
+           _loops->loop_info.at(header->get_func())
+               .in_loop(v->as<Instruction>()->get_parent(), header);
+}
+
+bool ResultType::is_invariant(const LinearExpr &expr,
+                              BasicBlock *header) const {
+    return all_of(expr.terms.begin(), expr.terms.end(),
+                  [&](auto &term) { return not in_loop(term.first, header); });
+}
+
+optional<AddRec> ResultType::get(Value *v) const {
+    auto it = _cache.find(v);
+    if (it != _cache.end())
+        return it->second;
+    auto ret = compute(v);
+    _cache[v] = ret;
+    return ret;
+}
+
+optional<AddRec> ResultType::get_at(Value *v, BasicBlock *header) const {
+    auto rec = get(v);
+    if (not rec.has_value())
+        return nullopt;
+    if (rec->loop == header)
+        return rec;
+    if (rec->is_invariant() and is_invariant(rec->start, header))
+        return AddRec{rec->start, {0}, header};
+    // a recurrence of an enclosing loop does not change in the inner one
+    if (not in_loop(v, header))
+        return AddRec{LinearExpr::of(v), {0}, header};
+    return nullopt;
+}
+
+optional<AddRec> ResultType::compute(Value *v) const {
+    if (not v->get_type()->is<IntType>())
+        return nullopt;
+    if (v->is<ConstInt>())
+        return AddRec{LinearExpr::of(v)};
+
+    auto scale = [&](Value *op, int k) -> optional<AddRec> {
+        auto rec = get(op);
+        if (not rec.has_value())
+            return nullopt;
+        return AddRec{rec->start * k, rec->step * k, rec->loop};
+    };
+
+    optional<AddRec> ret;
+    if (v->is<IBinaryInst>()) {
+        auto inst = v->as<IBinaryInst>();
+        auto lhs = inst->lhs(), rhs = inst->rhs();
+        switch (inst->get_ibin_op()) {
+        case IBinaryInst::ADD:
+            ret = combine(lhs, rhs, false);
+            break;
+        case IBinaryInst::SUB:
+            ret = combine(lhs, rhs, true);
+            break;
+        case IBinaryInst::MUL:
+            if (rhs->is<ConstInt>())
+                ret = scale(lhs, rhs->as<ConstInt>()->val());
+            else if (lhs->is<ConstInt>())
+                ret = scale(rhs, lhs->as<ConstInt>()->val());
+            break;
+        case IBinaryInst::SHL:
+            if (rhs->is<ConstInt>() and rhs->as<ConstInt>()->val() >= 0 and
+                rhs->as<ConstInt>()->val() < 31)
+                ret = scale(lhs, 1 << rhs->as<ConstInt>()->val());
+            break;
+        default:
+            break;
+        }
+    } else if (v->is<PhiInst>()) {
+        ret = compute_phi(v->as<PhiInst>());
+    }
+    // unknown
+    if (not ret.has_value())
+        ret = AddRec{LinearExpr::of(v)};
+    return ret;
+}
+
+optional<AddRec> ResultType::combine(Value *lhs, Value *rhs, bool sub) const {
+    auto l = get(lhs), r = get(rhs);
+    if (not l.has_value() or not r.has_value())
+        return nullopt;
+    auto fold = [&](const AddRec &a, const AddRec &b) {
+        return sub ? AddRec{a.start - b.start, a.step - b.step, a.loop}
+                   : AddRec{a.start + b.start, a.step + b.step, a.loop};
+    };
+    auto as_value = [&](Value *v, BasicBlock *loop) {
+        return AddRec{LinearExpr::of(v), {0}, loop};
+    };
+
+    if (l->loop == r->loop)
+        return fold(l.value(), r.value());
+    if (l->is_invariant() and is_invariant(l->start, r->loop))
+        return fold(AddRec{l->start, {0}, r->loop}, r.value());
+    if (r->is_invariant() and is_invariant(r->start, l->loop))
+        return fold(l.value(), AddRec{r->start, {0}, l->loop});
+    // one of them evolves in an enclosing loop of the other
+    if (not l->is_invariant() and not r->is_invariant()) {
+        auto &func_loops = _loops->loop_info.at(l->loop->get_func());
+        if (func_loops.nested_in(r->loop, l->loop) and
+            not in_loop(lhs, r->loop))
+            return fold(as_value(lhs, r->loop), r.value());
+        if (func_loops.nested_in(l->loop, r->loop) and
+            not in_loop(rhs, l->loop))
+            return fold(l.value(), as_value(rhs, l->loop));
+    }
+    return nullopt;
+}
+
+optional<AddRec> ResultType::compute_phi(PhiInst *phi) const {
+    auto header = phi->get_parent();
+    auto &func_loops = _loops->loop_info.at(header->get_func()).loops;
+    if (not contains(func_loops, header))
+        return nullopt;
+
+    auto pairs = phi->to_pairs();
+    if (pairs.size() != 2)
+        return nullopt;
+    Value *initial{nullptr}, *next{nullptr};
+    for (auto [value, source] : pairs) {
+        if (contains(loop(header).bbs, source))
+            next = value;
+        else
+            initial = value;
+    }
+    if (initial == nullptr or next == nullptr)
+        return nullopt;
+
+    auto step = parse_linear(next, phi, header);
+    if (not step.has_value() or step->coef(phi) != 1)
+        return nullopt;
+    step = step.value() - LinearExpr::of(phi);
+
+    auto start = get_at(initial, header);
+    if (not start.has_value() or not(start->step == LinearExpr{0}))
+        return nullopt;
+    return AddRec{start->start, step.value(), header};
+}
+
+optional<LinearExpr> ResultType::parse_linear(Value *v, PhiInst *phi,
+                                              BasicBlock *header) const {
+    if (v == phi)
+        return LinearExpr::of(phi);
+    if (not in_loop(v, header)) {
+        auto rec = get(v);
+        if (rec.has_value() and rec->is_invariant())
+            return rec->start;
+        return LinearExpr::of(v);
+    }
+    if (not v->is<IBinaryInst>())
+        return nullopt;
+
+    auto inst = v->as<IBinaryInst>();
+    auto lhs = parse_linear(inst->lhs(), phi, header);
+    if (not lhs.has_value())
+        return nullopt;
+    if (inst->get_ibin_op() == IBinaryInst::SHL) {
+        auto rhs = inst->rhs();
+        if (not rhs->is<ConstInt>() or rhs->as<ConstInt>()->val() < 0 or
+            rhs->as<ConstInt>()->val() >= 31)
+            return nullopt;
+        return lhs.value() * (1 << rhs->as<ConstInt>()->val());
+    }
+    auto rhs = parse_linear(inst->rhs(), phi, header);
+    if (not rhs.has_value())
+        return nullopt;
+    switch (inst->get_ibin_op()) {
+    case IBinaryInst::ADD:
+        return lhs.value() + rhs.value();
+    case IBinaryInst::SUB:
+        return lhs.value() - rhs.value();
+    case IBinaryInst::MUL:
+        if (rhs->is_const())
+            return lhs.value() * rhs->constant;
+        if (lhs->is_const())
+            return rhs.value() * lhs->constant;
+        return nullopt;
+    default:
+        return nullopt;
+    }
+}
+
+optional<TripCount> ResultType::trip_count(BasicBlock *header) const {
+    auto &l = loop(header);
+    if (l.latches.size() != 1 or l.exits.size() != 1 or
+        l.exits.begin()->first != header)
+        return nullopt;
+
+    auto &br = header->br_inst();
+    if (br.operands().size() != 3 or not br.get_operand(0)->is<ICmpInst>())
+        return nullopt;
+    auto icmp = br.get_operand(0)->as<ICmpInst>();
+    // exit if (lhs op rhs) holds
+    auto op = icmp->get_icmp_op();
+    if (contains(l.bbs, br.get_operand(1)->as<BasicBlock>()))
+        op = ICmpInst::not_icmp_op(op);
+
+    auto lhs = get_at(icmp->lhs(), header);
+    auto rhs = get_at(icmp->rhs(), header);
+    if (not lhs.has_value() or not rhs.has_value())
+        return nullopt;
+    // the induction variable on lhs, bound on rhs
+    if (lhs->step == LinearExpr{0}) {
+        swap(lhs, rhs);
+        op = ICmpInst::opposite_icmp_op(op);
+    }
+    if (not(rhs->step == LinearExpr{0}) or not lhs->step.is_const() or
+        lhs->step.constant == 0)
+        return nullopt;
+
+    auto s = lhs->start, b = rhs->start;
+    int d = lhs->step.constant;
+
+    if (s.is_const() and b.is_const()) {
+        auto k = first_exit(s.constant, d, b.constant, op);
+        if (not k.has_value())
+            return nullopt;
+        return TripCount{{k.value()}};
+    }
+
+    TripCount ret;
+    switch (op) {
+    case ICmpInst::EQ:
+        // continue while s + k * d != b, assuming it hits b exactly
+        ret = {b - s, d, false};
+        break;
+    case ICmpInst::GT:
+        if (d < 0)
+            return nullopt;
+        ret = {b - s + d, d, true};
+        break;
+    case ICmpInst::GE:
+        if (d < 0)
+            return nullopt;
+        ret = {b - s + (d - 1), d, true};
+        break;
+    case ICmpInst::LT:
+        if (d > 0)
+            return nullopt;
+        ret = {s - b - d, -d, true};
+        break;
+    case ICmpInst::LE:
+        if (d > 0)
+            return nullopt;
+        ret = {s - b - d - 1, -d, true};
+        break;
+    case ICmpInst::NE:
+        return nullopt;
+    }
+    if (ret.divisor == -1) {
+        ret.dividend = ret.dividend * -1;
+        ret.divisor = 1;
+    }
+    if (ret.dividend.is_const()) {
+        if (not ret.clamp and ret.dividend.constant % ret.divisor != 0)
+            return nullopt;
+        auto n = ret.dividend.constant / ret.divisor;
+        if (ret.clamp)
+            n = max(n, 0);
+        ret = {{n}};
+    }
+    return ret;
+}
+
+optional<LinearExpr> ResultType::exit_value(Value *v,
+                                            BasicBlock *header) const {
+    if (in_loop(v, header) and v->as<Instruction>()->get_parent() != header)
+        return nullopt;
+    auto rec = get_at(v, header);
+    if (not rec.has_value())
+        return nullopt;
+    if (rec->step == LinearExpr{0})
+        return rec->start;
+    auto n = trip_count(header);
+    if (not n.has_value() or not n->is_const())
+        return nullopt;
+    return rec->start + rec->step * n->const_val();
+}
+
+bool ResultType::has_exit_value(Value *v, BasicBlock *header) const {
+    if (in_loop(v, header) and v->as<Instruction>()->get_parent() != header)
+        return false;
+    auto rec = get_at(v, header);
+    return rec.has_value() and
+           (rec->step == LinearExpr{0} or trip_count(header).has_value());
+}
+
+Value *ResultType::expand(const LinearExpr &expr, Instruction *pos) const {
+    auto bb = pos->get_parent();
+    auto &consts = Constants::get();
+    auto binary = [&](IBinaryInst::IBinOp op, Value *lhs, Value *rhs) {
+        return bb->insert_inst<IBinaryInst>(pos, op, lhs, rhs);
+    };
+
+    Value *ret{nullptr};
+    for (auto [v, k] : expr.terms) {
+        if (ret and k == -1) {
+            ret = binary(IBinaryInst::SUB, ret, v);
+            continue;
+        }
+        auto term =
+            k == 1 ? v : binary(IBinaryInst::MUL, v, consts.int_const(k));
+        ret = ret ? binary(IBinaryInst::ADD, ret, term) : term;
+    }
+    if (ret == nullptr)
+        return consts.int_const(expr.constant);
+    if (expr.constant != 0)
+        ret = binary(IBinaryInst::ADD, ret, consts.int_const(expr.constant));
+    return ret;
+}
+
+Value *ResultType::expand(const TripCount &n, Instruction *pos) const {
+    auto bb = pos->get_parent();
+    auto &consts = Constants::get();
+    auto binary = [&](IBinaryInst::IBinOp op, Value *lhs, Value *rhs) {
+        return bb->insert_inst<IBinaryInst>(pos, op, lhs, rhs);
+    };
+
+    auto ret = expand(n.dividend, pos);
+    if (n.divisor != 1)
+        ret = binary(IBinaryInst::SDIV, ret, consts.int_const(n.divisor));
+    if (n.clamp) {
+        // max(0, x) = x * ((x >> 31) + 1), as there is no select
+        auto sign = binary(IBinaryInst::ASHR, ret, consts.int_const(31));
+        ret = binary(IBinaryInst::MUL, ret,
+                     binary(IBinaryInst::ADD, sign, consts.int_const(1)));
+    }
+    return ret;
+}
+
+Value *ResultType::expand_exit_value(Value *v, BasicBlock *header,
+                                     Instruction *pos) const {
+    if (not has_exit_value(v, header))
+        return nullptr;
+    if (auto linear = exit_value(v, header); linear.has_value())
+        return expand(linear.value(), pos);
+    auto rec = get_at(v, header);
+    auto n = trip_count(header);
+
+    auto bb = pos->get_parent();
+    auto start = expand(rec->start, pos);
+    auto step = expand(rec->step, pos);
+    auto iters = expand(n.value(), pos);
+    auto offset =
+        bb->insert_inst<IBinaryInst>(pos, IBinaryInst::MUL, iters, step);
+    return bb->insert_inst<IBinaryInst>(pos, IBinaryInst::ADD, start, offset);
+}
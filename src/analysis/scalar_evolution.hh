@@ -0,0 +1,142 @@
+#pragma once
+
+#include "basic_block.hh"
+#include "instruction.hh"
+#include "loop_find.hh"
+#include "pass.hh"
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pass {
+
+// c + a1 * v1 + a2 * v2 + ..., wraps as i32
+struct LinearExpr {
+    int constant{0};
+    std::vector<std::pair<ir::Value *, int>> terms;
+
+    LinearExpr() = default;
+    LinearExpr(int c) : constant(c) {}
+    // a constant if v is ConstInt
+    static LinearExpr of(ir::Value *v);
+
+    bool is_const() const { return terms.empty(); }
+    int coef(ir::Value *v) const;
+
+    LinearExpr operator+(const LinearExpr &rhs) const;
+    LinearExpr operator-(const LinearExpr &rhs) const;
+    LinearExpr operator*(int k) const;
+    bool operator==(const LinearExpr &rhs) const;
+};
+
+/* add recurrence {start, +, step}<loop>, the value in the k-th iteration
+ * (counting from 0) of the loop with header `loop` is start + k * step
+ *
+ * start and step only use values invariant in the loop, a value that does not
+ * evolve in any loop is a recurrence whose loop is nullptr and step is 0
+ */
+struct AddRec {
+    LinearExpr start, step{0};
+    ir::BasicBlock *loop{nullptr};
+
+    bool is_invariant() const { return loop == nullptr; }
+};
+
+// how many times the backedge is taken, i.e. the body is executed:
+//   n = dividend / divisor, or max(0, dividend / divisor) if clamp
+struct TripCount {
+    LinearExpr dividend;
+    int divisor{1};
+    bool clamp{false};
+
+    bool is_const() const {
+        return dividend.is_const() and divisor == 1 and not clamp;
+    }
+    int const_val() const { return dividend.constant; }
+};
+
+/* scalar evolution of the i32 values in loops
+ *
+ * header phis stepping by a loop invariant amount are induction variables,
+ * add/sub of recurrences (of the same loop or an enclosing one) and mul/shl by
+ * constants are recurrences as well, anything else is an unknown value
+ *
+ * trip counts are computed for loops that exit only from the header, by
+ * comparing a recurrence with an invariant bound. constant trip counts are
+ * exact (nullopt if the induction variable would wrap), symbolic ones assume
+ * it does not wrap
+ */
+class ScalarEvolution final : public AnalysisPass {
+  public:
+    class ResultType {
+        friend class ScalarEvolution;
+
+      public:
+        // nullopt if v is not an i32 value
+        std::optional<AddRec> get(ir::Value *v) const;
+        // v as a recurrence of the loop, nullopt if v evolves in another loop
+        // that is not an enclosing one
+        std::optional<AddRec> get_at(ir::Value *v,
+                                     ir::BasicBlock *header) const;
+
+        bool is_invariant(const LinearExpr &expr,
+                          ir::BasicBlock *header) const;
+
+        std::optional<TripCount> trip_count(ir::BasicBlock *header) const;
+        // the value of v (defined in the header or out of the loop) when the
+        // loop exits, nullopt if it is not linear, e.g. the trip count is not
+        // a constant
+        std::optional<LinearExpr> exit_value(ir::Value *v,
+                                             ir::BasicBlock *header) const;
+        // whether expand_exit_value works, the value may be symbolic
+        bool has_exit_value(ir::Value *v, ir::BasicBlock *header) const;
+
+        // insert the insts computing the value before `pos`, which should be
+        // dominated by the header (or be in the preheader) of the loop
+        ir::Value *expand(const LinearExpr &expr, ir::Instruction *pos) const;
+        ir::Value *expand(const TripCount &n, ir::Instruction *pos) const;
+        // nullptr if the exit value is unknown
+        ir::Value *expand_exit_value(ir::Value *v, ir::BasicBlock *header,
+                                     ir::Instruction *pos) const;
+
+        // drop the cached recurrences, for passes that erase insts
+        void forget() const { _cache.clear(); }
+
+      private:
+        const LoopFind::ResultType *_loops{nullptr};
+        mutable std::unordered_map<ir::Value *, std::optional<AddRec>> _cache;
+
+        const LoopFind::ResultType::LoopInfo &
+        loop(ir::BasicBlock *header) const;
+        bool in_loop(ir::Value *v, ir::BasicBlock *header) const;
+
+        std::optional<AddRec> compute(ir::Value *v) const;
+        std::optional<AddRec> compute_phi(ir::PhiInst *phi) const;
+        // v as phi + invariants, where phi is a header phi of the loop
+        std::optional<LinearExpr> parse_linear(ir::Value *v, ir::PhiInst *phi,
+                                               ir::BasicBlock *header) const;
+        std::optional<AddRec> combine(ir::Value *lhs, ir::Value *rhs,
+                                      bool sub) const;
+    };
+
+    void get_analysis_usage(AnalysisUsage &AU) const final {
+        using KillType = AnalysisUsage::KillType;
+        AU.set_kill_type(KillType::None);
+        AU.add_require<LoopFind>();
+    }
+
+    std::any get_result() const final { return &_result; }
+
+    bool run(PassManager *mgr) final;
+
+    void clear() final {
+        _result._cache.clear();
+        _result._loops = nullptr;
+    }
+
+  private:
+    ResultType _result;
+};
+
+} // namespace pass
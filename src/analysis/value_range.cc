@@ -0,0 +1,434 @@
+#include "value_range.hh"
+#include "constant.hh"
+#include "type.hh"
+#include "utils.hh"
+#include <algorithm>
+#include <cstdlib>
+#include <initializer_list>
+#include <vector>
+
+using namespace pass;
+using namespace ir;
+using namespace std;
+
+namespace {
+
+// a phi is widened after growing this many times
+constexpr unsigned widen_after = 2;
+// rounds of narrowing after the widened ranges are stable
+constexpr unsigned narrow_rounds = 2;
+// guards looked at for one value, and the depth of known bits
+constexpr unsigned max_guards = 16;
+constexpr unsigned max_depth = 4;
+
+bool is_tracked(Value *v) {
+    return v->get_type()->is<IntType>() or v->get_type()->is<BoolType>();
+}
+
+IntRange full_of(Value *v) {
+    if (v->get_type()->is<BoolType>())
+        return {0, 1};
+    if (v->get_type()->is<I64IntType>())
+        return {INT64_MIN, INT64_MAX};
+    return IntRange::full();
+}
+
+// the full range if it does not fit in i32, as the value may have wrapped
+IntRange checked(int64_t lo, int64_t hi) {
+    if (lo < INT32_MIN or hi > INT32_MAX)
+        return IntRange::full();
+    return {lo, hi};
+}
+
+IntRange hull(initializer_list<int64_t> vals) {
+    auto [lo, hi] = minmax_element(vals.begin(), vals.end());
+    return checked(*lo, *hi);
+}
+
+ICmpInst::ICmpOp swapped(ICmpInst::ICmpOp op) {
+    switch (op) {
+    case ICmpInst::GT:
+        return ICmpInst::LT;
+    case ICmpInst::GE:
+        return ICmpInst::LE;
+    case ICmpInst::LT:
+        return ICmpInst::GT;
+    case ICmpInst::LE:
+        return ICmpInst::GE;
+    default:
+        return op;
+    }
+}
+
+// the number of bits to hold v >= 0
+unsigned bit_width(int64_t v) {
+    unsigned width = 0;
+    while (v >> width)
+        ++width;
+    return width;
+}
+
+} // namespace
+
+IntRange IntRange::join(const IntRange &rhs) const {
+    if (is_empty())
+        return rhs;
+    if (rhs.is_empty())
+        return *this;
+    return {min(lo, rhs.lo), max(hi, rhs.hi)};
+}
+
+IntRange IntRange::meet(const IntRange &rhs) const {
+    IntRange ret{max(lo, rhs.lo), min(hi, rhs.hi)};
+    return ret.is_empty() ? empty() : ret;
+}
+
+unsigned KnownBits::trailing_zeros() const {
+    unsigned k = 0;
+    while (k < 32 and (zero >> k & 1))
+        ++k;
+    return k;
+}
+
+bool ValueRange::run(PassManager *mgr) {
+    clear();
+    auto &dom = mgr->get_result<Dominator>();
+    auto m = mgr->get_module();
+    for (auto &f_r : m->functions()) {
+        auto f = &f_r;
+        if (f->is_external)
+            continue;
+        _result.ranges[f].build(dom.at(f));
+    }
+    return false;
+}
+
+void RangeInfo::build(const DomTree &dom) {
+    _range.clear();
+    _edge_guard.clear();
+    _guard.clear();
+    collect_guards(dom);
+
+    // a def comes before its uses, except for the phis
+    vector<Instruction *> order;
+    for (DomTree::Index i = 0; i < dom.size(); ++i) {
+        for (auto &inst : dom.bb(i)->insts()) {
+            if (not is_tracked(&inst))
+                continue;
+            order.push_back(&inst);
+            _range[&inst] = IntRange::empty();
+        }
+    }
+
+    unordered_map<Instruction *, unsigned> grown;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto inst : order) {
+            auto &r = _range.at(inst);
+            auto joined = r.join(compute(inst));
+            if (joined == r)
+                continue;
+            if (inst->is<PhiInst>() and not r.is_empty() and
+                ++grown[inst] > widen_after) {
+                if (joined.lo < r.lo)
+                    joined.lo = full_of(inst).lo;
+                if (joined.hi > r.hi)
+                    joined.hi = full_of(inst).hi;
+            }
+            r = joined;
+            changed = true;
+        }
+    }
+    for (unsigned round = 0; round < narrow_rounds; ++round) {
+        for (auto inst : order) {
+            auto &r = _range.at(inst);
+            r = r.meet(compute(inst));
+        }
+    }
+}
+
+// a bb with a single pred is only reached by one edge of its branch
+void RangeInfo::collect_guards(const DomTree &dom) {
+    for (DomTree::Index i = 0; i < dom.size(); ++i) {
+        auto bb = dom.bb(i);
+        const Guard *parent = i == 0 ? nullptr : _guard.at(dom.idom(bb));
+        _guard[bb] = parent;
+        if (bb->pre_bbs().size() != 1)
+            continue;
+        auto pre = *bb->pre_bbs().begin();
+        auto br = &pre->insts().back();
+        if (not br->is<BrInst>() or br->operands().size() != 3 or
+            br->get_operand(1) == br->get_operand(2))
+            continue;
+        bool taken = br->get_operand(1) == bb;
+        _edge_guard[bb] = {br->get_operand(0), taken, parent};
+        _guard[bb] = &_edge_guard.at(bb);
+    }
+}
+
+IntRange RangeInfo::range(Value *v) const {
+    if (v->is<ConstInt>())
+        return IntRange::of(v->as<ConstInt>()->val());
+    if (v->is<ConstBool>())
+        return IntRange::of(v->as<ConstBool>()->val());
+    if (v->is<ConstZero>())
+        return IntRange::of(0);
+    auto it = _range.find(v);
+    if (it != _range.end())
+        return it->second;
+    return full_of(v);
+}
+
+IntRange RangeInfo::range_at(Value *v, BasicBlock *bb) const {
+    auto r = range(v);
+    if (v->is<Constant>())
+        return r;
+    auto it = _guard.find(bb);
+    if (it == _guard.end())
+        return r;
+    unsigned cnt = 0;
+    for (auto guard = it->second; guard and cnt < max_guards;
+         guard = guard->next, ++cnt) {
+        r = refine(v, r, guard);
+    }
+    return r;
+}
+
+IntRange RangeInfo::range_on_edge(Value *v, BasicBlock *from,
+                                  BasicBlock *to) const {
+    auto r = range_at(v, from);
+    auto br = &from->insts().back();
+    if (not br->is<BrInst>() or br->operands().size() != 3 or
+        br->get_operand(1) == br->get_operand(2))
+        return r;
+    Guard guard{br->get_operand(0), br->get_operand(1) == to, nullptr};
+    return refine(v, r, &guard);
+}
+
+// v op other holds if the guard is taken
+IntRange RangeInfo::refine(Value *v, IntRange r, const Guard *guard) const {
+    auto cond = guard->cond;
+    if (not is_tracked(v))
+        return r;
+    if (cond == v)
+        return r.meet(IntRange::of(guard->taken));
+    if (not cond->is<ICmpInst>())
+        return r;
+    auto icmp = cond->as<ICmpInst>();
+    auto op = icmp->get_icmp_op();
+    if (not guard->taken)
+        op = ICmpInst::not_icmp_op(op);
+    Value *other;
+    if (icmp->lhs() == v) {
+        other = icmp->rhs();
+    } else if (icmp->rhs() == v) {
+        other = icmp->lhs();
+        op = swapped(op);
+    } else {
+        return r;
+    }
+    auto o = range(other);
+    if (o.is_empty())
+        return r;
+    switch (op) {
+    case ICmpInst::EQ:
+        return r.meet(o);
+    case ICmpInst::NE:
+        if (o.is_single() and r.lo == o.lo)
+            return r.meet({r.lo + 1, r.hi});
+        if (o.is_single() and r.hi == o.lo)
+            return r.meet({r.lo, r.hi - 1});
+        return r;
+    case ICmpInst::LT:
+        return r.meet({INT32_MIN, o.hi - 1});
+    case ICmpInst::LE:
+        return r.meet({INT32_MIN, o.hi});
+    case ICmpInst::GT:
+        return r.meet({o.lo + 1, INT32_MAX});
+    case ICmpInst::GE:
+        return r.meet({o.lo, INT32_MAX});
+    }
+    return r;
+}
+
+IntRange RangeInfo::compute(Instruction *inst) const {
+    auto bb = inst->get_parent();
+    if (inst->is<PhiInst>()) {
+        auto ret = IntRange::empty();
+        for (auto &&[val, pre] : inst->as<PhiInst>()->to_pairs()) {
+            if (::contains(_guard, pre))
+                ret = ret.join(range_on_edge(val, pre, bb));
+        }
+        return ret;
+    }
+    if (inst->is<IBinaryInst>())
+        return compute_ibinary(inst->as<IBinaryInst>());
+    if (inst->is<ICmpInst>())
+        return compute_icmp(inst->as<ICmpInst>(), bb);
+    if (inst->is<ZextInst>())
+        return range_at(inst->get_operand(0), bb);
+    return full_of(inst);
+}
+
+IntRange RangeInfo::compute_ibinary(IBinaryInst *inst) const {
+    auto bb = inst->get_parent();
+    auto a = range_at(inst->lhs(), bb), b = range_at(inst->rhs(), bb);
+    if (a.is_empty() or b.is_empty())
+        return IntRange::empty();
+    if (inst->get_type()->is<BoolType>()) {
+        if (a.is_single() and b.is_single())
+            return IntRange::of(a.lo ^ b.lo);
+        return {0, 1};
+    }
+    switch (inst->get_ibin_op()) {
+    case IBinaryInst::ADD:
+        return checked(a.lo + b.lo, a.hi + b.hi);
+    case IBinaryInst::SUB:
+        return checked(a.lo - b.hi, a.hi - b.lo);
+    case IBinaryInst::MUL:
+        return hull({a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi});
+    case IBinaryInst::SDIV: {
+        // dividing by 0 never happens
+        if (b.lo == 0)
+            b.lo = 1;
+        if (b.hi == 0)
+            b.hi = -1;
+        if (b.is_empty())
+            return IntRange::empty();
+        if (b.contains(-1) or b.contains(1)) {
+            auto m = max(llabs(a.lo), llabs(a.hi));
+            return checked(-m, m);
+        }
+        return hull({a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi});
+    }
+    case IBinaryInst::SREM: {
+        // the result has the sign of the dividend and is smaller than the
+        // divisor, it is the dividend itself if that is small enough
+        int64_t m = max(llabs(b.lo), llabs(b.hi)) - 1;
+        if (-m <= a.lo and a.hi <= m)
+            return a;
+        return {a.lo >= 0 ? 0 : max(a.lo, -m), a.hi <= 0 ? 0 : min(a.hi, m)};
+    }
+    case IBinaryInst::XOR:
+        if (a.is_non_negative() and b.is_non_negative())
+            return {0, (1LL << bit_width(max(a.hi, b.hi))) - 1};
+        return IntRange::full();
+    case IBinaryInst::SHL:
+        if (not b.is_single() or b.lo < 0 or b.lo > 31)
+            return IntRange::full();
+        return checked(a.lo * (1LL << b.lo), a.hi * (1LL << b.lo));
+    case IBinaryInst::ASHR:
+        if (not b.is_single() or b.lo < 0 or b.lo > 31)
+            return {min(a.lo, int64_t{0}), max(a.hi, int64_t{0})};
+        return {a.lo >> b.lo, a.hi >> b.lo};
+    case IBinaryInst::LSHR:
+        if (a.is_non_negative())
+            return b.is_single() and b.lo >= 0 and b.lo <= 31
+                       ? IntRange{a.lo >> b.lo, a.hi >> b.lo}
+                       : IntRange{0, a.hi};
+        if (not b.is_single() or b.lo <= 0 or b.lo > 31)
+            return IntRange::full();
+        if (a.hi < 0)
+            return {static_cast<uint32_t>(a.lo) >> b.lo,
+                    static_cast<uint32_t>(a.hi) >> b.lo};
+        return {0, UINT32_MAX >> b.lo};
+    }
+    return IntRange::full();
+}
+
+IntRange RangeInfo::compute_icmp(ICmpInst *icmp, BasicBlock *bb) const {
+    auto a = range_at(icmp->lhs(), bb), b = range_at(icmp->rhs(), bb);
+    if (a.is_empty() or b.is_empty())
+        return IntRange::empty();
+    auto decided = [](bool is_true, bool is_false) {
+        if (is_true)
+            return IntRange::of(1);
+        return is_false ? IntRange::of(0) : IntRange{0, 1};
+    };
+    switch (icmp->get_icmp_op()) {
+    case ICmpInst::EQ:
+        return decided(a.is_single() and a == b, a.meet(b).is_empty());
+    case ICmpInst::NE:
+        return decided(a.meet(b).is_empty(), a.is_single() and a == b);
+    case ICmpInst::LT:
+        return decided(a.hi < b.lo, a.lo >= b.hi);
+    case ICmpInst::LE:
+        return decided(a.hi <= b.lo, a.lo > b.hi);
+    case ICmpInst::GT:
+        return decided(a.lo > b.hi, a.hi <= b.lo);
+    case ICmpInst::GE:
+        return decided(a.lo >= b.hi, a.hi < b.lo);
+    }
+    return {0, 1};
+}
+
+KnownBits RangeInfo::known_bits(Value *v, BasicBlock *bb) const {
+    return known_bits(v, bb, max_depth);
+}
+
+KnownBits RangeInfo::known_bits(Value *v, BasicBlock *bb,
+                                unsigned depth) const {
+    auto r = range_at(v, bb);
+    if (r.is_single())
+        return KnownBits::of(r.lo);
+    KnownBits ret;
+    // the high bits of a non-negative value
+    if (r.is_non_negative())
+        ret.zero = ~((1ULL << bit_width(r.hi)) - 1);
+    if (depth == 0 or not v->is<Instruction>())
+        return ret;
+    auto low_zeros = [](unsigned k) -> uint32_t {
+        return k >= 32 ? UINT32_MAX : (1U << k) - 1;
+    };
+    if (v->is<PhiInst>()) {
+        KnownBits merged{UINT32_MAX, UINT32_MAX};
+        for (auto &&[val, pre] : v->as<PhiInst>()->to_pairs()) {
+            if (not ::contains(_guard, pre))
+                continue;
+            auto kb = known_bits(val, pre, depth - 1);
+            merged.zero &= kb.zero;
+            merged.one &= kb.one;
+        }
+        ret.zero |= merged.zero;
+        ret.one |= merged.one;
+        return ret;
+    }
+    if (not v->is<IBinaryInst>() or not v->get_type()->is<IntType>())
+        return ret;
+    auto inst = v->as<IBinaryInst>();
+    auto a = known_bits(inst->lhs(), bb, depth - 1);
+    auto b = known_bits(inst->rhs(), bb, depth - 1);
+    auto shift = range_at(inst->rhs(), bb);
+    bool const_shift = shift.is_single() and shift.lo >= 0 and shift.lo <= 31;
+    switch (inst->get_ibin_op()) {
+    case IBinaryInst::ADD:
+    case IBinaryInst::SUB:
+        ret.zero |= low_zeros(min(a.trailing_zeros(), b.trailing_zeros()));
+        break;
+    case IBinaryInst::MUL:
+        ret.zero |= low_zeros(a.trailing_zeros() + b.trailing_zeros());
+        break;
+    case IBinaryInst::SHL:
+        if (const_shift) {
+            ret.zero |= (a.zero << shift.lo) | low_zeros(shift.lo);
+            ret.one |= a.one << shift.lo;
+        }
+        break;
+    case IBinaryInst::LSHR:
+        if (const_shift) {
+            ret.zero |= (a.zero >> shift.lo) | ~(UINT32_MAX >> shift.lo);
+            ret.one |= a.one >> shift.lo;
+        }
+        break;
+    case IBinaryInst::ASHR:
+        if (const_shift) {
+            ret.zero |= static_cast<int32_t>(a.zero) >> shift.lo;
+            ret.one |= static_cast<int32_t>(a.one) >> shift.lo;
+        }
+        break;
+    default:
+        break;
+    }
+    return ret;
+}
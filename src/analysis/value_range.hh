@@ -0,0 +1,129 @@
+#pragma once
+
+#include "basic_block.hh"
+#include "dominator.hh"
+#include "function.hh"
+#include "instruction.hh"
+#include "pass.hh"
+#include "value.hh"
+#include <cstdint>
+#include <unordered_map>
+
+namespace pass {
+
+// the signed range [lo, hi] of an i32 (or i1) value, empty if lo > hi
+struct IntRange {
+    int64_t lo, hi;
+
+    static IntRange full() { return {INT32_MIN, INT32_MAX}; }
+    static IntRange empty() { return {1, 0}; }
+    static IntRange of(int64_t v) { return {v, v}; }
+
+    bool is_empty() const { return lo > hi; }
+    bool is_single() const { return lo == hi; }
+    bool contains(int64_t v) const { return lo <= v and v <= hi; }
+    bool is_non_negative() const { return not is_empty() and lo >= 0; }
+
+    // the smallest range holding both
+    IntRange join(const IntRange &rhs) const;
+    IntRange meet(const IntRange &rhs) const;
+    bool operator==(const IntRange &rhs) const {
+        return (is_empty() and rhs.is_empty()) or
+               (lo == rhs.lo and hi == rhs.hi);
+    }
+    bool operator!=(const IntRange &rhs) const { return not(*this == rhs); }
+};
+
+// the bits that are 0 (or 1) in every value taken
+struct KnownBits {
+    uint32_t zero{0}, one{0};
+
+    static KnownBits of(uint32_t v) { return {~v, v}; }
+
+    unsigned trailing_zeros() const;
+    // the low k bits are all 0
+    bool low_bits_zero(unsigned k) const {
+        return k == 0 or (~zero & ((1ULL << k) - 1)) == 0;
+    }
+};
+
+/* ranges of the i32 values in a function, computed sparsely over SSA
+ *
+ * the values are iterated in the order of the dominator tree until nothing
+ * changes, starting from empty ranges. a phi that keeps growing (e.g. an
+ * induction variable) is widened to the limit of i32, and narrowed back by a
+ * few more rounds without widening, which bounds it again by the exit
+ * condition of its loop
+ *
+ * a conditional branch bounds the operands of its icmp in the bbs only
+ * reached through one of its edges, range_at applies all such conditions
+ * dominating the bb. arithmetic that may wrap gives the full range
+ */
+class RangeInfo {
+  public:
+    void build(const DomTree &dom);
+
+    // the range wherever v is used, the full range if unknown
+    IntRange range(ir::Value *v) const;
+    // with the conditions of the branches leading to bb
+    IntRange range_at(ir::Value *v, ir::BasicBlock *bb) const;
+    // known bits of v by its definition, e.g. the low bits of a shl
+    KnownBits known_bits(ir::Value *v, ir::BasicBlock *bb) const;
+
+    bool is_non_negative(ir::Value *v, ir::BasicBlock *bb) const {
+        return range_at(v, bb).is_non_negative();
+    }
+
+  private:
+    // the branch condition holding in a bb, and the next one dominating it
+    struct Guard {
+        ir::Value *cond;
+        bool taken;
+        const Guard *next;
+    };
+
+    std::unordered_map<ir::Value *, IntRange> _range;
+    std::unordered_map<ir::BasicBlock *, Guard> _edge_guard;
+    // the nearest guard dominating the bb, only for the reachable bbs
+    std::unordered_map<ir::BasicBlock *, const Guard *> _guard;
+
+    void collect_guards(const DomTree &dom);
+    IntRange refine(ir::Value *v, IntRange r, const Guard *guard) const;
+    IntRange range_on_edge(ir::Value *v, ir::BasicBlock *from,
+                           ir::BasicBlock *to) const;
+
+    IntRange compute(ir::Instruction *inst) const;
+    IntRange compute_ibinary(ir::IBinaryInst *inst) const;
+    IntRange compute_icmp(ir::ICmpInst *icmp, ir::BasicBlock *bb) const;
+    KnownBits known_bits(ir::Value *v, ir::BasicBlock *bb,
+                         unsigned depth) const;
+};
+
+class ValueRange final : public AnalysisPass {
+  public:
+    struct ResultType {
+        std::unordered_map<ir::Function *, RangeInfo> ranges;
+
+        const RangeInfo &at(ir::Function *f) const { return ranges.at(f); }
+        IntRange range_at(ir::Value *v, ir::BasicBlock *bb) const {
+            return at(bb->get_func()).range_at(v, bb);
+        }
+    };
+
+    void get_analysis_usage(AnalysisUsage &AU) const final {
+        using KillType = AnalysisUsage::KillType;
+        AU.set_kill_type(KillType::None);
+        AU.add_require<Dominator>();
+    }
+
+    std::any get_result() const final { return &_result; }
+
+    bool run(PassManager *mgr) final;
+
+    void clear() final { _result.ranges.clear(); }
+
+  private:
+    ResultType _result;
+};
+
+} // namespace pass
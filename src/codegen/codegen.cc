@@ -1356,14 +1356,15 @@ void CodeGen::resolve_stack() {
     if (not Imm12bit::check_in_range(
             Offset2int(SP_ALIGN(stack_grow_size) + max_off))) {
         // the offset will overflow on 12bit imm
-        bool need_new_temp_reg = false;
+        // reuse the last loaded tmp reg, if there is an int one
+        bool need_new_temp_reg =
+            load_order.empty() or load_order.back()->is_float_usage();
         if (rd_info.as_stack_object.has_value()) {
             auto rd_offset = frame_location.at(rd_info.as_stack_object.value());
             if (not Imm12bit::check_in_range(
                     Offset2int(SP_ALIGN(stack_grow_size) + rd_offset)))
                 need_new_temp_reg = true;
-        } else if (i_idx == 0)
-            need_new_temp_reg = true;
+        }
         tmp_addr_reg =
             as_a<IPReg>(need_new_temp_reg ? find_tmp_reg(false)
                                           : tmp_reg_map.at(load_order.back()));
@@ -2,6 +2,7 @@
 
 #include "context.hh"
 #include "instruction.hh"
+#include "mem_report.hh"
 #include "mir_builder.hh"
 #include "mir_function.hh"
 #include "mir_immediate.hh"
@@ -58,6 +59,7 @@ class CodeGen {
             bool stage1_only = false) {
         mir::MIRBuilder builder(std::move(ir_module));
         _mir_module.reset(builder.release());
+        MemReport::get().checkpoint("mir");
         _allocator.run(_mir_module.get());
         if (not stage1_only) {
             upgrade();
@@ -72,6 +72,9 @@ struct LivenessAnalysis {
 struct LiveInterVal {
     const mir::IPReg::RegIDType vreg_id;
     ProgramPoint start{std::numeric_limits<ProgramPoint>::max()}, end{0};
+    // the cost of spilling it, i.e. the frequencies of its uses and defs,
+    // divided by its length
+    double weight{0};
 
     LiveInterVal(mir::IPReg::RegIDType id) : vreg_id(id) {}
     LiveInterVal(mir::IPReg::RegIDType id, ProgramPoint l, ProgramPoint r)
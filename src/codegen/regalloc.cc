@@ -72,8 +72,23 @@ LinearScanImpl::LiveInts RegAlloc::make_interval(mir::Function *func,
             ints.at(vreg_id).update(i);
         }
     }
+    for (auto label : get_cfg_info(func).label_order) {
+        for (auto &inst : label->get_insts()) {
+            for (unsigned i = 0; i < inst.get_operand_num(); ++i) {
+                auto op = inst.get_operand(i);
+                if ((for_float and is_a<const FVReg>(op)) or
+                    (not for_float and is_a<const IVReg>(op))) {
+                    auto it = ints.find(as_a<const Register>(op)->get_id());
+                    if (it != ints.end())
+                        it->second.weight += label->get_freq();
+                }
+            }
+        }
+    }
     LinearScanImpl::LiveInts res;
     for (auto [_, interval] : ints) {
+        // a long interval with few uses frees a register for a long time
+        interval.weight /= interval.end - interval.start + 1;
         if (interval.check())
             res.insert(interval);
     }
@@ -26,9 +26,20 @@ void LinearScanImpl::expire_old_intervals(const LiveInterVal &ref) {
     }
 }
 
+// spill the cheapest one of interval and the active ones ending after it,
+// the one ending the latest if they cost the same
 void LinearScanImpl::spill_at(const LiveInterVal &interval) {
-    auto spill = _active.rbegin();
-    if (spill->end > interval.end) {
+    auto spill = _active.rend();
+    double weight = interval.weight;
+    for (auto it = _active.rbegin();
+         it != _active.rend() and it->end > interval.end; ++it) {
+        if (spill == _active.rend() ? it->weight <= weight
+                                    : it->weight < weight) {
+            spill = it;
+            weight = it->weight;
+        }
+    }
+    if (spill != _active.rend()) {
         auto iter = _map.find(spill->vreg_id);
         assert(iter != _map.end());
         auto physical_reg = iter->second;
@@ -19,7 +19,9 @@ class Function;
  * - !terminated: ret/br will check not termination, but other insts donot, so i
  * - !insert position: the ret/br should be inserted to end only
  */
-class BasicBlock : public Value, public ilist<BasicBlock>::node {
+class BasicBlock : public Value,
+                   public ilist<BasicBlock>::node,
+                   public LiveCounter<BasicBlock> {
     friend class BrInst;
 
     using InstIter = ilist<Instruction>::iterator;
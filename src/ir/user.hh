@@ -54,11 +54,16 @@ class User : public Value {
 
     void remove_operand(size_t idx) {
         assert(idx < _operands.size());
+        // an operand is nullptr if its def has been erased, e.g. in an
+        // unreachable bb
         for (unsigned i = idx + 1; i < _operands.size(); ++i) {
+            if (not _operands[i])
+                continue;
             _operands[i]->remove_use(this, i);
             _operands[i]->add_use(this, i - 1);
         }
-        _operands[idx]->remove_use(this, idx);
+        if (_operands[idx])
+            _operands[idx]->remove_use(this, idx);
         _operands.erase(_operands.begin() + idx);
     }
 
@@ -88,7 +93,7 @@ class User : public Value {
     std::vector<Value *> _operands;
 };
 
-struct Use {
+struct Use : public LiveCounter<Use> {
     User *user;
     unsigned op_idx;
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "mem_report.hh"
 #include "utils.hh"
 
 #include <functional>
@@ -14,7 +15,7 @@ class Module;
 class User;
 struct Use;
 
-class Value {
+class Value : public LiveCounter<Value> {
   public:
     Value(Type *type, std::string &&name) : _type(type), _name(name) {}
     ~Value() { replace_all_use_with(nullptr); }
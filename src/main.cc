@@ -12,13 +12,17 @@
 #include <vector>
 
 #include "algebraic_simplify.hh"
+#include "alias_analysis.hh"
 #include "array_visit.hh"
 #include "ast.hh"
+#include "block_frequency.hh"
+#include "call_graph.hh"
 #include "codegen.hh"
 #include "const_propagate.hh"
 #include "continuous_addition.hh"
 #include "control_flow.hh"
 #include "dead_code.hh"
+#include "dependence.hh"
 #include "depth_order.hh"
 #include "dominator.hh"
 #include "err.hh"
@@ -37,13 +41,20 @@
 #include "loop_simplify.hh"
 #include "loop_unroll.hh"
 #include "mem2reg.hh"
+#include "mem_report.hh"
+#include "memory_ssa.hh"
 #include "naive_rec_opt.hh"
 #include "pass.hh"
 #include "phi_combine.hh"
+#include "post_dominator.hh"
 #include "raw_ast.hh"
+#include "reg_pressure.hh"
+#include "remark.hh"
 #include "remove_unreach_bb.hh"
 #include "rm_useless_loop.hh"
+#include "scalar_evolution.hh"
 #include "strength_reduce.hh"
+#include "value_range.hh"
 
 using namespace std;
 using namespace filesystem;
@@ -53,8 +64,12 @@ class Config {
   public:
     bool emit_llvm{false}; // emit llvm or asm
     bool optimize{false};
+    bool mem_report{false};
     string in;
     optional<string> out;
+    // optimization remarks
+    optional<string> rpass, rpass_missed;
+    bool remarks_yaml{false};
 
     Config(int argc, char **argv) : args(argv + 1, argv + argc) {
         auto emit_asm = is_cmd_option_exist("-S");
@@ -63,6 +78,17 @@ class Config {
         }
         emit_llvm = is_cmd_option_exist("-emit-llvm");
         optimize = is_cmd_option_exist("-O1");
+        mem_report = is_cmd_option_exist("-mem-report");
+        rpass = get_cmd_option_value("-Rpass=");
+        rpass_missed = get_cmd_option_value("-Rpass-missed=");
+        auto remarks_format = get_cmd_option_value("-remarks-format=");
+        if (remarks_format.has_value()) {
+            if (remarks_format.value() == "yaml") {
+                remarks_yaml = true;
+            } else if (remarks_format.value() != "text") {
+                throw runtime_error{"unknown remarks format"};
+            }
+        }
         out = get_cmd_option("-o");
         // expect one and only one source file
         if (args.size() != 1) {
@@ -84,6 +110,19 @@ class Config {
         return ret;
     }
 
+    // for options in the form of `-option=value`
+    optional<string> get_cmd_option_value(const string &prefix) {
+        auto it = find_if(args.begin(), args.end(), [&](const string &arg) {
+            return arg.rfind(prefix, 0) == 0;
+        });
+        if (it == args.end()) {
+            return nullopt;
+        }
+        auto ret = string{*it}.substr(prefix.size());
+        args.erase(it);
+        return ret;
+    }
+
     bool is_cmd_option_exist(const string &option) {
         auto it = find(args.begin(), args.end(), option);
         if (it == args.end()) {
@@ -106,25 +145,64 @@ int main(int argc, char **argv) {
         debugs << "=========Debug Info For " << filename << "=========\n";
     }
 
-    ast::AST ast{ast::RawAST{cfg.in}};
+    auto &mem_report = MemReport::get();
+    if (cfg.mem_report) {
+        // NOTE: Constants and mir::ValueManager are never freed, so the live
+        // counts of ir::Value and mir::Value never drop back to zero
+        mem_report.enable();
+        mem_report.add_counter("ir::Value", LiveCounter<ir::Value>::live);
+        mem_report.add_counter("ir::Use", LiveCounter<ir::Use>::live);
+        mem_report.add_counter("ir::BB", LiveCounter<ir::BasicBlock>::live);
+        mem_report.add_counter("mir::Inst",
+                               LiveCounter<mir::Instruction>::live);
+        mem_report.add_counter("mir::Value", LiveCounter<mir::Value>::live);
+    }
+
+    auto &remarks = RemarkEmitter::get();
+    if (cfg.rpass.has_value()) {
+        remarks.set_filter(RemarkEmitter::Kind::Applied, cfg.rpass.value());
+    }
+    if (cfg.rpass_missed.has_value()) {
+        remarks.set_filter(RemarkEmitter::Kind::Missed,
+                           cfg.rpass_missed.value());
+    }
+    if (cfg.remarks_yaml) {
+        remarks.set_format(RemarkEmitter::Format::YAML);
+    }
+
+    ast::RawAST raw_ast{cfg.in};
+    mem_report.checkpoint("parse");
+
+    ast::AST ast{std::move(raw_ast)};
+    mem_report.checkpoint("ast");
 
     IRBuilder builder{ast};
     auto module = builder.release_module();
+    mem_report.checkpoint("ir");
 
     PassManager pm{std::move(module)};
 
     // analysis
     pm.add_pass<Dominator>();
+    pm.add_pass<PostDominator>();
     pm.add_pass<LoopFind>();
+    pm.add_pass<ScalarEvolution>();
+    pm.add_pass<CallGraph>();
     pm.add_pass<FuncInfo>();
     pm.add_pass<DepthOrder>();
+    pm.add_pass<AliasAnalysis>();
+    pm.add_pass<DependenceAnalysis>();
+    pm.add_pass<ValueRange>();
+    pm.add_pass<BlockFrequency>();
+    pm.add_pass<RegPressure>();
+    pm.add_pass<MemorySSA>();
 
     // transform
     pm.add_pass<RmUnreachBB>();
     pm.add_pass<LoopSimplify>();
     pm.add_pass<LoopInvariant>(); // TODO set changed
     pm.add_pass<ConstPro>();
-    pm.add_pass<DeadCode>();
+    pm.add_pass<DeadCode>(cfg.optimize);
     pm.add_pass<ControlFlow>();
     pm.add_pass<GlobalVarLocalize>();
     pm.add_pass<ContinuousAdd>();
@@ -173,6 +251,7 @@ int main(int argc, char **argv) {
         debugs << pm.print_passes_runned() << "\n";
     }
     module = pm.release_module();
+    mem_report.checkpoint("passes");
 
     // output
     ostream *os{nullptr};
@@ -196,5 +275,10 @@ int main(int argc, char **argv) {
         delete os;
     }
 
+    if (cfg.mem_report) {
+        mem_report.checkpoint(cfg.emit_llvm ? "emit-llvm" : "codegen");
+        mem_report.print(cerr);
+    }
+
     return 0;
 }
@@ -95,7 +95,8 @@ class Comment : public Value {
     }
 };
 
-class Instruction final : public ilist<Instruction>::node {
+class Instruction final : public ilist<Instruction>::node,
+                          public LiveCounter<Instruction> {
     friend class Label;
 
   private:
@@ -24,6 +24,8 @@ class Label : public Value {
     std::vector<Label *> _succ_labels;
     ilist<Instruction> _insts;
     Instruction *_first_branch{nullptr};
+    // the estimated times it runs per call of the function
+    double _freq{1};
 
     Label(std::string name) : _name(name) {}
     Label(LabelType type, std::string name) : _type(type), _name(name) {}
@@ -39,6 +41,8 @@ class Label : public Value {
     const std::vector<Label *> &get_succ() const { return _succ_labels; }
     const LabelType get_type() const { return _type; }
     const std::string &get_name() const { return _name; }
+    double get_freq() const { return _freq; }
+    void set_freq(double freq) { _freq = freq; }
 
     void rm_prev(Label *prev) {
         auto iter = std::find(_prev_labels.begin(), _prev_labels.end(), prev);
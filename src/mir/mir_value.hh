@@ -1,5 +1,7 @@
 #pragma once
 
+#include "mem_report.hh"
+
 #include <iostream>
 #include <unordered_set>
 
@@ -11,7 +13,7 @@ namespace mir {
 
 using context::Context;
 
-class Value {
+class Value : public LiveCounter<Value> {
   public:
     virtual void dump(std::ostream &os, const Context &context) const = 0;
     virtual ~Value() {}
@@ -1,4 +1,5 @@
 #include "mir_builder.hh"
+#include "block_frequency.hh"
 #include "constant.hh"
 #include "err.hh"
 #include "instruction.hh"
@@ -89,10 +90,22 @@ MIRBuilder::MIRBuilder(unique_ptr<ir::Module> &&mod)
     }
 
     // generate mir-instruction, maintain prev-succ-info for labels
-    for (auto &ir_function : ir_module->get_functions()) {
+    for (auto &ir_function : ir_module->functions()) {
         cur_func = as_a<Function>(value_map.at(&ir_function));
-        for (auto &BB : ir_function.get_bbs()) {
+        // the ranges of the values are known after all the passes, e.g. for
+        // division by constant, and the frequencies go to the labels for
+        // the register allocation
+        pass::FreqInfo freqs;
+        if (not ir_function.is_external) {
+            pass::DomTree dom;
+            dom.build(&ir_function);
+            cur_ranges.build(dom);
+            freqs.build(dom);
+        }
+        for (auto &BB : ir_function.bbs()) {
+            cur_bb = &BB;
             cur_label = as_a<Label>(value_map.at(&BB));
+            cur_label->set_freq(freqs.freq(&BB));
             // maintain prev-succ-info for labels
             for (auto prev_bb : BB.pre_bbs())
                 cur_label->add_prev(as_a<Label>(value_map.at(prev_bb)));
@@ -385,7 +398,9 @@ any MIRBuilder::visit(const ir::ZextInst *instruction) {
 }
 
 // ref: https://gmplib.org/~tege/divcnst-pldi94.pdf
-void MIRBuilder::build_sdiv_by_const(Value *res, Value *n, int d) {
+// the rounding towards zero for negative n is skipped if n is non-negative
+void MIRBuilder::build_sdiv_by_const(Value *res, Value *n, int d,
+                                     bool non_neg) {
     constexpr int N = 32;
     auto pow2 = [](size_t a) { return 1ULL << a; };
 
@@ -404,7 +419,9 @@ void MIRBuilder::build_sdiv_by_const(Value *res, Value *n, int d) {
         return;
     }
 
-    if (d_abs == pow2(l)) {
+    if (d_abs == pow2(l) and non_neg) {
+        cur_label->add_inst(mir::SRAIW, {res, n, create<Imm12bit>(l)});
+    } else if (d_abs == pow2(l)) {
         if (l > 1) {
             cur_label->add_inst(SRAIW, {res, n, create<Imm12bit>(l - 1)});
         }
@@ -415,17 +432,21 @@ void MIRBuilder::build_sdiv_by_const(Value *res, Value *n, int d) {
     } else if (m < pow2(N - 1)) {
         cur_label->add_inst(MUL, {res, n, load_imm(m)});
         cur_label->add_inst(mir::SRAI, {res, res, create<Imm12bit>(N + l - 1)});
-        auto tmp = create<IVReg>();
-        cur_label->add_inst(SRLIW, {tmp, n, create<Imm12bit>(N - 1)});
-        cur_label->add_inst(mir::ADDW, {res, res, tmp});
+        if (not non_neg) {
+            auto tmp = create<IVReg>();
+            cur_label->add_inst(SRLIW, {tmp, n, create<Imm12bit>(N - 1)});
+            cur_label->add_inst(mir::ADDW, {res, res, tmp});
+        }
     } else {
         cur_label->add_inst(MUL, {res, n, load_imm(m - pow2(N))});
         cur_label->add_inst(mir::SRAI, {res, res, create<Imm12bit>(N)});
         cur_label->add_inst(mir::ADDW, {res, res, n});
         cur_label->add_inst(mir::SRAI, {res, res, create<Imm12bit>(l - 1)});
-        auto tmp = create<IVReg>();
-        cur_label->add_inst(SRLIW, {tmp, n, create<Imm12bit>(N - 1)});
-        cur_label->add_inst(mir::ADDW, {res, res, tmp});
+        if (not non_neg) {
+            auto tmp = create<IVReg>();
+            cur_label->add_inst(SRLIW, {tmp, n, create<Imm12bit>(N - 1)});
+            cur_label->add_inst(mir::ADDW, {res, res, tmp});
+        }
     }
 
     if (d < 0) {
@@ -490,7 +511,7 @@ bool MIRBuilder::build_sdiv_by_const(const ir::IBinaryInst *inst) {
         return false;
     }
 
-    build_sdiv_by_const(res, n, d);
+    build_sdiv_by_const(res, n, d, is_non_negative(inst->lhs()));
 
     return true;
 }
@@ -521,6 +542,16 @@ bool MIRBuilder::build_srem_by_const(const ir::IBinaryInst *inst) {
 
     auto d_abs = abs(static_cast<int64_t>(d));
     auto l = max(1L, static_cast<int64_t>(ceil(log2(d_abs))));
+    bool non_neg = is_non_negative(inst->lhs());
+
+    // n % 2^l is the low bits of n if n >= 0
+    if (non_neg and d_abs == pow2(l)) {
+        if (Imm12bit::check_in_range(d_abs - 1))
+            cur_label->add_inst(ANDI, {res, n, create<Imm12bit>(d_abs - 1)});
+        else
+            cur_label->add_inst(AND, {res, n, load_imm(d_abs - 1)});
+        return true;
+    }
 
     // save 1 inst
     if (d >= 2 && d_abs == pow2(l) && l >= 1 && l <= 11) {
@@ -535,7 +566,7 @@ bool MIRBuilder::build_srem_by_const(const ir::IBinaryInst *inst) {
         return true;
     }
 
-    build_sdiv_by_const(res, n, d);
+    build_sdiv_by_const(res, n, d, non_neg);
     build_mul_by_const(res, res, d);
     cur_label->add_inst(SUBW, {res, n, res});
 
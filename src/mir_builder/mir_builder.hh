@@ -17,6 +17,7 @@
 #include "module.hh"
 #include "type.hh"
 #include "value.hh"
+#include "value_range.hh"
 
 #include <any>
 #include <cassert>
@@ -41,6 +42,8 @@ class MIRBuilder : public ir::InstructionVisitor {
     /* runtime variable */
     Function *cur_func;
     Label *cur_label;
+    ir::BasicBlock *cur_bb;
+    pass::RangeInfo cur_ranges;
 
     /* core data structure */
     // map ir-value to mir-value
@@ -68,6 +71,10 @@ class MIRBuilder : public ir::InstructionVisitor {
 
     void phi_elim_at_the_end();
 
+    bool is_non_negative(ir::Value *v) {
+        return cur_ranges.is_non_negative(v, cur_bb);
+    }
+
     // load Immediate into virtual register
     Register *load_imm(int imm, IVReg *target_reg = nullptr) {
         if (imm) {
@@ -301,7 +308,7 @@ class MIRBuilder : public ir::InstructionVisitor {
     virtual any visit(const ir::TruncInst *instruction) override final;
 
     // specialized inst builder
-    void build_sdiv_by_const(Value *res, Value *n, int d);
+    void build_sdiv_by_const(Value *res, Value *n, int d, bool non_neg);
     void build_mul_by_const(Value *res, Value *n, int d);
     bool build_sdiv_by_const(const ir::IBinaryInst *inst);
     bool build_srem_by_const(const ir::IBinaryInst *inst);
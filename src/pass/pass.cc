@@ -50,13 +50,15 @@ bool PassManager::run_single_pass(PassIDType passid, bool force, bool post) {
     switch (AU._kt) {
     case AnalysisUsage::Normal:
         for (auto killid : AU._kills) {
-            if (contains(_passes, killid))
+            if (contains(_passes, killid) and
+                not contains(AU._preserves, killid))
                 at(killid).mark_killd();
         }
         break;
     case AnalysisUsage::All:
-        for (auto &[_, passinfo] : _passes)
-            if (is_a<AnalysisPass>(passinfo.get()))
+        for (auto &[id, passinfo] : _passes)
+            if (is_a<AnalysisPass>(passinfo.get()) and
+                not contains(AU._preserves, id))
                 passinfo.mark_killd();
         break;
     case AnalysisUsage::None:
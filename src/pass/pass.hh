@@ -53,12 +53,15 @@ class AnalysisUsage {
     PassOrder _posts{};
     // after the host pass run, the results of _kills is invalidate
     PassOrder _kills{};
-    // may need a preserve list
+    // passes in _preserves are kept valid by the host pass itself, whatever
+    // the kill type is
+    PassOrder _preserves{};
 
     void clear() {
         _relys.clear();
         _posts.clear();
         _kills.clear();
+        _preserves.clear();
     }
 
   public:
@@ -76,6 +79,10 @@ class AnalysisUsage {
         _kills.push_back(PassID<RequireType>());
     }
 
+    template <typename RequireType> void add_preserve() {
+        _preserves.push_back(PassID<RequireType, AnalysisPass>());
+    }
+
     void set_kill_type(KillType kt) { _kt = kt; }
 };
 
@@ -125,6 +132,7 @@ class PassManager {
         void mark_killd() { valid = false; }
         void mark_valid() { valid = (not aws_inv) and true; }
         bool need_run() const { return not valid; }
+        bool is_valid() const { return valid; }
         Pass *get() { return ptr.get(); }
     };
 
@@ -160,6 +168,21 @@ class PassManager {
         return *std::any_cast<const ResultType *>(reuslt_ptr);
     }
 
+    // for passes that preserve an analysis by updating it in place, returns
+    // nullptr instead of running the analysis if it is not valid now
+    template <typename PassName,
+              typename ResultType = typename PassName::ResultType>
+    ResultType *get_result_if_valid() {
+        auto ID = PassID<PassName, AnalysisPass>();
+        PassInfo &info = at(ID);
+        if (not info.is_valid()) {
+            return nullptr;
+        }
+        auto reuslt_ptr = as_a<const AnalysisPass>(info.get())->get_result();
+        return const_cast<ResultType *>(
+            std::any_cast<const ResultType *>(reuslt_ptr));
+    }
+
     void run(const PassOrder &o, bool post = true);
     void run_iteratively(const PassOrder &order);
 
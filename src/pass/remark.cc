@@ -0,0 +1,52 @@
+#include "remark.hh"
+
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using namespace pass;
+
+// single quoted YAML scalar
+static string yaml_quote(const string &s) {
+    string ret{"'"};
+    for (auto c : s) {
+        if (c == '\'')
+            ret += "''";
+        else
+            ret += c;
+    }
+    return ret + "'";
+}
+
+void RemarkEmitter::emit(Kind kind, const string &pass, const string &name,
+                         ir::BasicBlock *bb, const string &msg) {
+    if (not enabled(kind, pass))
+        return;
+
+    auto func = bb->get_func()->get_name();
+    auto block = bb->get_name();
+
+    ostringstream ss;
+    switch (_format) {
+    case Format::Text:
+        ss << (kind == Kind::Applied ? "remark: " : "remark-missed: ") << func
+           << ":" << block << ": " << msg << " [-Rpass"
+           << (kind == Kind::Applied ? "" : "-missed") << "=" << pass << "]\n";
+        break;
+    case Format::YAML:
+        ss << "--- !" << (kind == Kind::Applied ? "Passed" : "Missed") << "\n"
+           << "Pass:     " << yaml_quote(pass) << "\n"
+           << "Name:     " << yaml_quote(name) << "\n"
+           << "Function: " << yaml_quote(func) << "\n"
+           << "Block:    " << yaml_quote(block) << "\n"
+           << "Message:  " << yaml_quote(msg) << "\n"
+           << "...\n";
+        break;
+    }
+
+    auto remark = ss.str();
+    if (contains(_emitted, remark))
+        return;
+    _emitted.insert(remark);
+    cerr << remark;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "basic_block.hh"
+#include "function.hh"
+
+#include <optional>
+#include <regex>
+#include <set>
+#include <string>
+
+namespace pass {
+
+/* optimization remarks, enabled by `-Rpass=<regex>` / `-Rpass-missed=<regex>`
+ *
+ * the regex is matched against the pass name (e.g. loop-unroll, inline, gvn,
+ * licm), remarks are written to stderr as text or YAML (`-remarks-format=yaml`)
+ *
+ * passes that run iteratively tend to emit the same remark again and again,
+ * so identical remarks are only written once
+ */
+class RemarkEmitter {
+  public:
+    enum class Kind { Applied, Missed };
+    enum class Format { Text, YAML };
+
+    static RemarkEmitter &get() {
+        static RemarkEmitter emitter;
+        return emitter;
+    }
+
+    void set_filter(Kind kind, const std::string &pattern) {
+        filter(kind).emplace(pattern);
+    }
+    void set_format(Format format) { _format = format; }
+
+    bool enabled(Kind kind, const std::string &pass) const {
+        auto &re = kind == Kind::Applied ? _applied : _missed;
+        return re.has_value() and std::regex_search(pass, re.value());
+    }
+
+    // @name: a short CamelCase tag identifying the reason, e.g. TooLarge
+    void emit(Kind kind, const std::string &pass, const std::string &name,
+              ir::BasicBlock *bb, const std::string &msg);
+
+    void applied(const std::string &pass, const std::string &name,
+                 ir::BasicBlock *bb, const std::string &msg) {
+        emit(Kind::Applied, pass, name, bb, msg);
+    }
+    void missed(const std::string &pass, const std::string &name,
+                ir::BasicBlock *bb, const std::string &msg) {
+        emit(Kind::Missed, pass, name, bb, msg);
+    }
+
+  private:
+    std::optional<std::regex> _applied, _missed;
+    Format _format{Format::Text};
+    std::set<std::string> _emitted;
+
+    std::optional<std::regex> &filter(Kind kind) {
+        return kind == Kind::Applied ? _applied : _missed;
+    }
+
+    RemarkEmitter() = default;
+};
+
+} // namespace pass
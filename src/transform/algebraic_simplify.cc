@@ -8,8 +8,10 @@
 #include "pass.hh"
 #include "type.hh"
 #include "value.hh"
+#include "value_range.hh"
 #include <any>
 #include <cassert>
+#include <cstdlib>
 #include <type_traits>
 
 using namespace pass;
@@ -25,10 +27,12 @@ Constant *get_cint(int v, bool i64) {
 
 bool AlgebraicSimplify::run(PassManager *mgr) {
     bool changed = false;
+    auto &value_range = mgr->get_result<ValueRange>();
     for (auto &func_r : mgr->get_module()->functions()) {
         if (func_r.is_external)
             continue;
         ignores.clear();
+        ranges = &value_range.at(&func_r);
         for (auto &bb_r : func_r.bbs()) {
             bb = &bb_r;
             auto &insts = bb_r.insts();
@@ -90,6 +94,38 @@ __attribute__((optnone)) bool AlgebraicSimplify::apply_rules() {
         return true;
     }
 
+    /* by the ranges of the operands */
+    if (not i64 and (idiv(any_val(v1), is_cint_like(c1))->match(inst) or
+                     irem(any_val(v1), is_cint_like(c1))->match(inst))) {
+        bool is_div = inst->as<IBinaryInst>()->get_ibin_op() ==
+                      IBinaryInst::SDIV;
+        auto r = ranges->range_at(v1, bb);
+        int64_t c_abs = std::abs(static_cast<int64_t>(c1));
+        // a / c -> 0, a % c -> a if |a| < |c|
+        if (not r.is_empty() and -c_abs < r.lo and r.hi < c_abs) {
+            inst->replace_all_use_with(is_div ? get_cint(0, i64) : v1);
+            return true;
+        }
+        unsigned k = 0;
+        while (k < 31 and (int64_t{1} << k) < c_abs)
+            ++k;
+        if (c1 > 1 and (int64_t{1} << k) == c1) {
+            // a / 2^k -> a >> k if a >= 0 or the division is exact
+            if (is_div and (r.is_non_negative() or
+                            ranges->known_bits(v1, bb).low_bits_zero(k))) {
+                auto ashr =
+                    insert_ibin(IBinaryInst::ASHR, v1, get_cint(k, i64));
+                inst->replace_all_use_with(ashr);
+                return true;
+            }
+            // a % 2^k -> 0 if the low k bits are 0
+            if (not is_div and ranges->known_bits(v1, bb).low_bits_zero(k)) {
+                inst->replace_all_use_with(get_cint(0, i64));
+                return true;
+            }
+        }
+    }
+
     /* continuous opration on const */
     // (v1 + c1) + c2 -> v1 + (c1 + c2)
     if (iadd(iadd(any_val(v1), is_cint_like(c1)), is_cint_like(c2))
@@ -3,9 +3,11 @@
 #include "basic_block.hh"
 #include "const_propagate.hh"
 #include "dead_code.hh"
+#include "dominator.hh"
 #include "functional"
 #include "instruction.hh"
 #include "pass.hh"
+#include "value_range.hh"
 #include <functional>
 #include <list>
 
@@ -17,7 +19,9 @@ class AlgebraicSimplify : public TransformPass {
     void get_analysis_usage(AnalysisUsage &AU) const override final {
         using KillType = AnalysisUsage::KillType;
         AU.set_kill_type(KillType::All);
+        AU.add_preserve<Dominator>();
         AU.add_require<ConstPro>();
+        AU.add_require<ValueRange>();
         AU.add_post<DeadCode>();
     }
     bool run(PassManager *mgr) override final;
@@ -26,6 +30,7 @@ class AlgebraicSimplify : public TransformPass {
     ir::BasicBlock *bb;
     ir::Instruction *inst;
     std::set<ir::Instruction *> ignores;
+    const RangeInfo *ranges;
 
     bool apply_rules();
 
@@ -1,7 +1,6 @@
 #include "array_visit.hh"
 #include "basic_block.hh"
 #include "depth_order.hh"
-#include "err.hh"
 #include "func_info.hh"
 #include "function.hh"
 #include "global_variable.hh"
@@ -16,52 +15,6 @@ using namespace std;
 using namespace pass;
 using namespace ir;
 
-ArrayVisit::AliasResult ArrayVisit::is_alias(MemAddress *lhs, MemAddress *rhs) {
-    auto l_base = lhs->get_base();
-    auto r_base = rhs->get_base();
-    if (lhs->get_ptr() == rhs->get_ptr())
-        return AliasResult::MustAlias;
-    if (is_a<GlobalVariable>(l_base)) {
-        if (is_a<GlobalVariable>(r_base)) {
-            if (l_base != r_base)
-                return AliasResult::NoAlias;
-            if (not(lhs->get_offset().has_value() &&
-                    rhs->get_offset().has_value()))
-                return AliasResult::MayAlias;
-            if (lhs->get_offset().value() == rhs->get_offset().value())
-                return AliasResult::MustAlias;
-            else
-                return AliasResult::NoAlias;
-        } else if (is_a<Argument>(r_base))
-            // r_base may be l_base as parameter passed by caller
-            // func(l_base[1][2])->func(r_base)
-            return AliasResult::MayAlias;
-        else
-            return AliasResult::NoAlias;
-    } else if (is_a<AllocaInst>(l_base)) {
-        if (is_a<AllocaInst>(r_base)) {
-            if (l_base != r_base)
-                return AliasResult::NoAlias;
-            if (not(lhs->get_offset().has_value() &&
-                    rhs->get_offset().has_value()))
-                return AliasResult::MayAlias;
-            if (lhs->get_offset().value() == rhs->get_offset().value())
-                return AliasResult::MustAlias;
-            else
-                return AliasResult::NoAlias;
-        }
-        // if any of base is not AllocaInst, it is absolutely not alias
-        // because AllocaInst must be local
-        return AliasResult::NoAlias;
-    } else if (is_a<Argument>(l_base)) {
-        if (is_a<AllocaInst>(r_base))
-            return AliasResult::NoAlias;
-        else
-            return AliasResult::MayAlias;
-    }
-    throw unreachable_error{};
-}
-
 void ArrayVisit::clear() {
     addrs.clear();
     latest_val.clear();
@@ -72,6 +25,7 @@ void ArrayVisit::clear() {
 bool ArrayVisit::run(pass::PassManager *mgr) {
     auto m = mgr->get_module();
     _func_info = &mgr->get_result<FuncInfo>();
+    _alias = &mgr->get_result<AliasAnalysis>();
     _depth_order = &mgr->get_result<DepthOrder>();
     clear();
     bool ir_changed = false;
@@ -114,7 +68,7 @@ bool ArrayVisit::run(pass::PassManager *mgr) {
             for (auto inst : del_store_load) {
                 inst->get_parent()->erase_inst(inst);
             }
-            // delete MemAddress
+            // delete MemLoc
             for (auto mem : addrs) {
                 delete mem;
             }
@@ -146,7 +100,7 @@ void ArrayVisit::mem_visit(BasicBlock *bb) {
             }
         } else if (is_a<LoadInst>(inst)) {
             auto ptr = inst->get_operand(0);
-            MemAddress *mem = alias_analysis(ptr, false);
+            MemLoc *mem = alias_analysis(ptr, false);
             // if mem has the latest val, then replace it
             if (latest_val[bb][mem]) {
                 replace_table[inst] = latest_val[bb][mem];
@@ -157,24 +111,24 @@ void ArrayVisit::mem_visit(BasicBlock *bb) {
                 latest_val[bb][mem] = inst;
             }
         }
-        // take a conservative strategy that any non_pure function may
-        // changed the current latest vals
-        else if (is_a<CallInst>(inst) &&
-                 not _func_info->is_pure_function(
-                     as_a<Function>(inst->get_operand(0)))) {
-            latest_val[bb].clear();
+        // a call only changes the latest vals it may write to
+        else if (is_a<CallInst>(inst)) {
+            for (auto &[mem, val] : latest_val[bb]) {
+                if (val and is_mod(_alias->get_mod_ref(inst, *mem)))
+                    val = nullptr;
+            }
         }
     }
 }
 
-// create MemAddress based on ptr and scan whether there is a alias MemAddress
-ArrayVisit::MemAddress *ArrayVisit::alias_analysis(Value *ptr, bool clear) {
-    auto new_mem = MemAddress(ptr);
-    MemAddress *ret_mem = nullptr;
+// create MemLoc based on ptr and scan whether there is a alias MemLoc
+MemLoc *ArrayVisit::alias_analysis(Value *ptr, bool clear) {
+    auto new_mem = AliasAnalysis::ResultType::location(ptr);
+    MemLoc *ret_mem = nullptr;
     for (auto mem : addrs) {
-        auto res = is_alias(mem, &new_mem);
-        // MustAlias: return MemAddress
-        // MayAlias: clear the val on the MemAddress
+        auto res = _alias->alias(*mem, new_mem);
+        // MustAlias: return MemLoc
+        // MayAlias: clear the val on the MemLoc
         // NoAlias: do nothing
         switch (res) {
         case AliasResult::MustAlias:
@@ -190,15 +144,15 @@ ArrayVisit::MemAddress *ArrayVisit::alias_analysis(Value *ptr, bool clear) {
         }
     }
     if (not ret_mem) {
-        ret_mem = new MemAddress(new_mem);
+        ret_mem = new MemLoc(new_mem);
         addrs.insert(ret_mem);
     }
     return ret_mem;
 }
 
-map<ArrayVisit::MemAddress *, Value *> ArrayVisit::join(BasicBlock *bb) {
+map<MemLoc *, Value *> ArrayVisit::join(BasicBlock *bb) {
     set<BasicBlock *>::iterator iter;
-    map<ArrayVisit::MemAddress *, Value *> in_latest_val{};
+    map<MemLoc *, Value *> in_latest_val{};
     for (iter = bb->pre_bbs().begin(); iter != bb->pre_bbs().end(); iter++) {
         if (visited[*iter]) {
             in_latest_val = latest_val[*iter++];
@@ -222,8 +176,8 @@ map<ArrayVisit::MemAddress *, Value *> ArrayVisit::join(BasicBlock *bb) {
     return in_latest_val;
 }
 
-bool ArrayVisit::equal(map<MemAddress *, Value *> &mem_vals1,
-                       map<MemAddress *, Value *> &mem_vals2) {
+bool ArrayVisit::equal(map<MemLoc *, Value *> &mem_vals1,
+                       map<MemLoc *, Value *> &mem_vals2) {
     if (mem_vals1.size() != mem_vals2.size())
         return false;
     auto l_iter = mem_vals1.begin();
@@ -5,6 +5,7 @@
 #include "instruction.hh"
 #include "utils.hh"
 #include "value.hh"
+#include "value_range.hh"
 #include <stdexcept>
 
 using namespace std;
@@ -14,6 +15,7 @@ using namespace ir;
 bool ConstPro::run(pass::PassManager *mgr) {
     auto m = mgr->get_module();
     changed = false;
+    value_range = &mgr->get_result<ValueRange>();
     for (auto &f_r : m->functions()) {
         {
             const_propa.clear();
@@ -33,6 +35,13 @@ void ConstPro::traverse(Function *func) {
             if (check(inst)) {
                 val2const[inst] = const_folder(inst);
                 work_list.push_back(inst);
+            } else if (is_a<ICmpInst>(inst)) {
+                // decided by the ranges of the operands
+                auto r = value_range->range_at(inst, &bb_r);
+                if (r.is_single()) {
+                    val2const[inst] = Constants::get().bool_const(r.lo);
+                    work_list.push_back(inst);
+                }
             }
         }
     }
@@ -42,7 +51,9 @@ void ConstPro::replace() {
     while (not work_list.empty()) {
         auto inst = work_list.front();
         work_list.pop_front();
-        if (check(inst) and not contains(const_propa, inst)) {
+        if ((contains(val2const, dynamic_cast<Value *>(inst)) or
+             check(inst)) and
+            not contains(const_propa, inst)) {
             if (not contains(val2const, dynamic_cast<Value *>(inst)))
                 val2const[inst] = const_folder(inst);
             for (auto &[user, _] : inst->get_use_list()) {
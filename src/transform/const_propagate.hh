@@ -1,10 +1,12 @@
 #pragma once
 #include "constant.hh"
 #include "dead_code.hh"
+#include "dominator.hh"
 #include "function.hh"
 #include "instruction.hh"
 #include "pass.hh"
 #include "value.hh"
+#include "value_range.hh"
 #include <deque>
 #include <map>
 #include <set>
@@ -17,6 +19,8 @@ class ConstPro final : public pass::TransformPass {
     virtual void get_analysis_usage(pass::AnalysisUsage &AU) const override {
         using KillType = pass::AnalysisUsage::KillType;
         AU.set_kill_type(KillType::All);
+        AU.add_require<pass::ValueRange>();
+        AU.add_preserve<pass::Dominator>();
         AU.add_post<pass::DeadCode>();
     }
     virtual bool run(pass::PassManager *mgr) override;
@@ -33,6 +37,7 @@ class ConstPro final : public pass::TransformPass {
     std::set<ir::Instruction *> const_propa;
     std::map<ir::Value *, ir::Constant *> val2const;
     std::deque<ir::Instruction *> work_list{};
+    const ValueRange::ResultType *value_range;
 };
 
 }; // namespace pass
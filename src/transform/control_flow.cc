@@ -16,6 +16,7 @@ using namespace ir;
 
 bool ControlFlow::run(pass::PassManager *mgr) {
     _depth_order = &mgr->get_result<DepthOrder>();
+    _dom = mgr->get_result_if_valid<Dominator>();
     auto m = mgr->get_module();
     changed = false;
     for (auto &f : m->functions()) {
@@ -29,7 +30,9 @@ bool ControlFlow::run(pass::PassManager *mgr) {
 }
 
 void ControlFlow::clean(ir::Function *func) {
+    using Update = DomTree::Update;
     redd_bbs_to_del.clear();
+    dom_updates.clear();
     for (auto bb : post_order) {
         if (bb == func->get_entry_bb())
             continue;
@@ -46,6 +49,7 @@ void ControlFlow::clean(ir::Function *func) {
                     only_1_reachable = as_a<ConstBool>(cond)->val() ? TBB : FBB;
                     auto unreach_bb = as_a<ConstBool>(cond)->val() ? FBB : TBB;
                     br2jump_resolve_phi(bb, unreach_bb);
+                    dom_updates.push_back({Update::Delete, bb, unreach_bb});
                 }
                 if (only_1_reachable) {
                     bb->erase_inst(inst);
@@ -71,6 +75,9 @@ void ControlFlow::clean(ir::Function *func) {
                         as_a<BasicBlock>(ToBB->insts().back().get_operand(1));
                     auto new_f_bb =
                         as_a<BasicBlock>(ToBB->insts().back().get_operand(2));
+                    dom_updates.push_back({Update::Delete, bb, ToBB});
+                    dom_updates.push_back({Update::Insert, bb, new_t_bb});
+                    dom_updates.push_back({Update::Insert, bb, new_f_bb});
                     for (auto &phi_r : new_t_bb->insts()) {
                         if (is_a<PhiInst>(&phi_r)) {
                             as_a<PhiInst>(&phi_r)->rm_phi_param_from(ToBB,
@@ -95,6 +102,9 @@ void ControlFlow::clean(ir::Function *func) {
             }
         }
     }
+    // the redundant bbs are still alive here, and unreachable now
+    if (_dom and not dom_updates.empty())
+        _dom->at(func).apply_updates(dom_updates);
     for (auto redd_bb : redd_bbs_to_del) {
         assert(redd_bb->get_use_list().size() == 0);
         func->erase_bb(redd_bb);
@@ -116,6 +126,12 @@ void ControlFlow::merge_bb(BasicBlock *redd_bb, BasicBlock *result_bb,
             }
         }
     }
+    using Update = DomTree::Update;
+    for (auto pre_bb : pre_bbs) {
+        dom_updates.push_back({Update::Delete, pre_bb, redd_bb});
+        dom_updates.push_back({Update::Insert, pre_bb, result_bb});
+    }
+    dom_updates.push_back({Update::Delete, redd_bb, result_bb});
     // 1.correct special operands changed by variation of bb
     if (pre_bbs.size() > 0) {
         // replace redundant_bb in PhiInst of result bb with pre_bb of
@@ -1,5 +1,6 @@
 #pragma once
 #include "basic_block.hh"
+#include "block_frequency.hh"
 #include "depth_order.hh"
 #include "dominator.hh"
 #include "function.hh"
@@ -7,8 +8,13 @@
 #include "instruction.hh"
 #include "loop_find.hh"
 #include "loop_simplify.hh"
+#include "memory_ssa.hh"
 #include "pass.hh"
+#include "post_dominator.hh"
+#include "reg_pressure.hh"
 #include "remove_unreach_bb.hh"
+#include "scalar_evolution.hh"
+#include "value_range.hh"
 #include <vector>
 
 namespace pass {
@@ -22,7 +28,13 @@ class ControlFlow final : public pass::TransformPass {
         AU.add_require<DepthOrder>();
         AU.add_post<RmUnreachBB>();
         AU.add_kill<DepthOrder>();
-        AU.add_kill<Dominator>();
+        AU.add_kill<PostDominator>();
+        AU.add_kill<ScalarEvolution>();
+        AU.add_kill<MemorySSA>();
+        AU.add_kill<ValueRange>();
+        AU.add_kill<RegPressure>();
+        AU.add_kill<BlockFrequency>();
+        AU.add_preserve<Dominator>();
         AU.set_kill_type(KillType::Normal);
     }
 
@@ -41,6 +53,8 @@ class ControlFlow final : public pass::TransformPass {
   private:
     bool changed;
     const DepthOrder::ResultType *_depth_order;
+    Dominator::ResultType *_dom;
+    std::vector<DomTree::Update> dom_updates;
     std::list<ir::BasicBlock *> post_order;
     std::vector<ir::BasicBlock *> redd_bbs_to_del;
 };
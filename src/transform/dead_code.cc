@@ -6,6 +6,7 @@
 #include "instruction.hh"
 #include "log.hh"
 #include "module.hh"
+#include "remove_unreach_bb.hh"
 #include "type.hh"
 #include "utils.hh"
 
@@ -17,12 +18,18 @@ using namespace ir;
 
 bool DeadCode::run(PassManager *mgr) {
     _func_info = &mgr->get_result<FuncInfo>();
+    _alias = &mgr->get_result<AliasAnalysis>();
+    auto post_dom = aggressive ? &mgr->get_result<PostDominator>() : nullptr;
+    _dom = mgr->get_result_if_valid<Dominator>();
+    _call_graph = mgr->get_result_if_valid<CallGraph>();
     auto m = mgr->get_module();
     changed = false;
     for (auto &f_r : m->functions()) {
         if (f_r.is_external)
             continue;
         auto f = &f_r;
+        if (aggressive)
+            _post_dom = &post_dom->at(f);
         mark_sweep(f);
     }
     sweep_globally(m);
@@ -47,12 +54,23 @@ void DeadCode::mark_sweep(Function *func) {
     }
     // Perform the Mark phase
     mark();
+    bool redirected = aggressive and redirect_dead_branches(func);
     // Perfrom the Sweep phase
     sweep(func);
+    // RmUnreachBB can not be a post pass of DeadCode, while LoopFind expects
+    // no unreachable bbs when Dominator is preserved
+    if (redirected)
+        remove_unreachable(func);
 }
 
 // Perform the Mark phase
 void DeadCode::mark() {
+    auto mark_live = [&](Instruction *inst) {
+        if (marked[inst])
+            return;
+        marked[inst] = true;
+        work_list.push_back(inst);
+    };
     while (not work_list.empty()) {
         auto inst = work_list.front();
         work_list.pop_front();
@@ -64,6 +82,19 @@ void DeadCode::mark() {
             marked[op_inst] = true;
             work_list.push_back(op_inst);
         }
+        if (not aggressive)
+            continue;
+        // the branches deciding whether a live bb runs are live
+        auto bb = inst->get_parent();
+        if (_post_dom->contains(bb)) {
+            for (auto dep : _post_dom->control_deps(bb))
+                mark_live(&dep->br_inst());
+        }
+        // so are the branches deciding which value a live phi takes
+        if (is_a<PhiInst>(inst)) {
+            for (auto &&[_, incoming] : as_a<PhiInst>(inst)->to_pairs())
+                mark_live(&incoming->br_inst());
+        }
     }
 }
 
@@ -72,10 +103,13 @@ void DeadCode::sweep(Function *func) {
     for (auto &bb : func->bbs()) {
         auto &insts = bb.insts();
         for (auto iter = insts.begin(); iter != insts.end();) {
-            if (marked[&*iter]) {
+            // in ADCE mode, dead branches have been rewritten to jumps
+            if (marked[&*iter] or (aggressive and is_a<BrInst>(&*iter))) {
                 ++iter;
                 continue;
             }
+            if (_call_graph and is_a<CallInst>(&*iter))
+                _call_graph->remove_call(as_a<CallInst>(&*iter));
             iter->replace_all_use_with(nullptr);
             iter = bb.erase_inst(&*iter);
             changed = true;
@@ -83,13 +117,82 @@ void DeadCode::sweep(Function *func) {
     }
 }
 
+// the nearest post dominator with something live is always reached after a
+// dead branch, and nothing live runs in between
+bool DeadCode::redirect_dead_branches(Function *func) {
+    using Update = DomTree::Update;
+    vector<Update> updates;
+    for (auto &bb_r : func->bbs()) {
+        auto bb = &bb_r;
+        auto br = &bb->insts().back();
+        if (not is_a<BrInst>(br) or marked[br] or br->operands().size() != 3)
+            continue;
+        auto target = _post_dom->ipdom(bb);
+        while (none_of(target->insts().begin(), target->insts().end(),
+                       [&](Instruction &inst) { return marked[&inst]; })) {
+            target = _post_dom->ipdom(target);
+        }
+        // the phis in the old successors are dead, and swept later
+        for (auto suc : bb->suc_bbs())
+            updates.push_back({Update::Delete, bb, suc});
+        updates.push_back({Update::Insert, bb, target});
+        bb->erase_inst(br);
+        bb->create_inst<BrInst>(target);
+    }
+    if (updates.empty())
+        return false;
+    if (_dom)
+        _dom->at(func).apply_updates(updates);
+    changed = true;
+    return true;
+}
+
+void DeadCode::remove_unreachable(Function *func) {
+    unordered_set<BasicBlock *> reachable{func->get_entry_bb()};
+    deque<BasicBlock *> bb_work_list{func->get_entry_bb()};
+    while (not bb_work_list.empty()) {
+        auto bb = bb_work_list.front();
+        bb_work_list.pop_front();
+        for (auto suc : bb->suc_bbs()) {
+            if (not contains(reachable, suc)) {
+                reachable.insert(suc);
+                bb_work_list.push_back(suc);
+            }
+        }
+    }
+    vector<BasicBlock *> unreachable;
+    for (auto &bb_r : func->bbs()) {
+        if (not contains(reachable, &bb_r))
+            unreachable.push_back(&bb_r);
+    }
+    for (auto bb : unreachable) {
+        if (_call_graph) {
+            for (auto &inst : bb->insts()) {
+                if (is_a<CallInst>(&inst))
+                    _call_graph->remove_call(as_a<CallInst>(&inst));
+            }
+        }
+        RmUnreachBB::remove_bb(bb);
+    }
+}
+
+// a branch that may decide whether the function returns at all is kept
+bool DeadCode::is_critical_branch(BasicBlock *bb) {
+    if (not _post_dom->contains(bb) or _post_dom->ipdom(bb) == nullptr)
+        return true;
+    return any_of(bb->suc_bbs().begin(), bb->suc_bbs().end(),
+                  [&](BasicBlock *suc) { return not _post_dom->contains(suc); });
+}
+
 bool DeadCode::is_critical(Instruction *inst) {
-    if (is_a<RetInst>(inst) || is_a<BrInst>(inst))
+    if (is_a<BrInst>(inst))
+        return not aggressive or is_critical_branch(inst->get_parent());
+    if (is_a<RetInst>(inst))
         return true;
     if (is_a<StoreInst>(inst))
         return not contains(store_not_critical, inst);
     if (is_a<CallInst>(inst) &&
-        not _func_info->is_pure_function(as_a<Function>(inst->operands()[0])))
+        _func_info->has_side_effect(as_a<Function>(inst->operands()[0])))
         return true;
     return false;
 }
@@ -106,12 +209,17 @@ void DeadCode::sweep_globally(Module *m) {
             unused_globals.push_back(&glob_var_r);
     }
     changed |= unused_funcs.size() or unused_globals.size();
-    for (auto func : unused_funcs)
+    for (auto func : unused_funcs) {
+        if (_call_graph)
+            _call_graph->remove_function(func);
         m->functions().erase(func);
+    }
     for (auto glob : unused_globals)
         m->global_vars().erase(glob);
 }
 
+// a store to a local array is useless if no load may read the element, as
+// long as the array never escapes
 void DeadCode::collect_store_not_critical(Function *func) {
     for (auto &bb : func->bbs()) {
         for (auto &alloca : bb.insts()) {
@@ -122,40 +230,44 @@ void DeadCode::collect_store_not_critical(Function *func) {
                     ->get_elem_type()
                     ->is_basic_type())
                 continue;
-            bool alloca_is_critical = false;
-            unordered_set<Instruction *> related_store;
-            for (auto &[arr_use, _] : alloca.get_use_list()) {
-                // store [value], arr-ptr
-                if (is_a<StoreInst>(arr_use)) {
-                    related_store.insert(as_a<Instruction>(arr_use));
-                    continue;
-                }
-                if (is_a<Ptr2IntInst>(arr_use)) {
-                    // algebraication
-                    // TODO
-                    alloca_is_critical = true;
-                } else if (is_a<GetElementPtrInst>(arr_use)) {
-                    // gep arr-ptr, [offs]
-                    for (auto &[use, _] :
-                         as_a<GetElementPtrInst>(arr_use)->get_use_list()) {
-                        if (is_a<StoreInst>(use)) {
-                            related_store.insert(as_a<Instruction>(use));
-                        } else {
-                            alloca_is_critical = true;
-                            break;
-                        }
-                    }
-                }
-                if (alloca_is_critical)
-                    break;
-            }
-            if (not alloca_is_critical) {
-                auto old_set = store_not_critical;
-                set_union(
-                    related_store.begin(), related_store.end(), old_set.begin(),
-                    old_set.end(),
-                    inserter(store_not_critical, store_not_critical.begin()));
+            vector<Instruction *> stores, loads;
+            if (not collect_array_access(&alloca, stores, loads))
+                continue;
+            vector<MemLoc> reads;
+            for (auto load : loads)
+                reads.push_back(
+                    AliasAnalysis::ResultType::location(load->get_operand(0)));
+            for (auto store : stores) {
+                auto loc = AliasAnalysis::ResultType::location(
+                    as_a<StoreInst>(store)->ptr());
+                // the load may be in another iteration of a loop
+                if (none_of(reads.begin(), reads.end(), [&](MemLoc &read) {
+                        return _alias->alias_at_any_time(read, loc) !=
+                               AliasResult::NoAlias;
+                    }))
+                    store_not_critical.insert(store);
             }
         }
     }
 }
+
+// returns false if the pointer escapes, e.g. passed to a call
+bool DeadCode::collect_array_access(Value *ptr, vector<Instruction *> &stores,
+                                    vector<Instruction *> &loads) {
+    for (auto &[user, idx] : ptr->get_use_list()) {
+        if (is_a<StoreInst>(user) and idx == 1) {
+            // store [value], arr-ptr
+            stores.push_back(as_a<Instruction>(user));
+        } else if (is_a<LoadInst>(user)) {
+            loads.push_back(as_a<Instruction>(user));
+        } else if (is_a<GetElementPtrInst>(user) and idx == 0) {
+            // gep arr-ptr, [offs]
+            if (not collect_array_access(user, stores, loads))
+                return false;
+        } else {
+            // ptr2int for algebraication, call, or stored as a value
+            return false;
+        }
+    }
+    return true;
+}
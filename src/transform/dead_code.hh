@@ -1,22 +1,36 @@
 #pragma once
+#include "alias_analysis.hh"
+#include "call_graph.hh"
+#include "dominator.hh"
 #include "func_info.hh"
 #include "function.hh"
 #include "instruction.hh"
 #include "module.hh"
 #include "pass.hh"
+#include "post_dominator.hh"
 #include <deque>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace pass {
 
 class DeadCode final : public pass::TransformPass {
   public:
-    DeadCode() = default;
+    /* aggressive (ADCE): branches are not critical either, a branch is only
+     * kept if some live bb is control dependent on it, otherwise it jumps to
+     * the nearest live post dominator directly
+     */
+    explicit DeadCode(bool aggressive = false) : aggressive(aggressive) {}
     virtual void get_analysis_usage(pass::AnalysisUsage &AU) const override {
         using KillType = pass::AnalysisUsage::KillType;
         AU.set_kill_type(KillType::All);
         AU.add_require<pass::FuncInfo>();
+        AU.add_require<pass::AliasAnalysis>();
+        if (aggressive)
+            AU.add_require<pass::PostDominator>();
+        AU.add_preserve<pass::Dominator>();
+        AU.add_preserve<pass::CallGraph>();
     }
     virtual bool run(pass::PassManager *mgr) override;
 
@@ -24,13 +38,25 @@ class DeadCode final : public pass::TransformPass {
     void mark_sweep(ir::Function *);
     void mark();
     void sweep(ir::Function *);
+    // returns whether any branch is redirected
+    bool redirect_dead_branches(ir::Function *);
+    void remove_unreachable(ir::Function *);
     void sweep_globally(ir::Module *);
 
     bool is_critical(ir::Instruction *);
+    bool is_critical_branch(ir::BasicBlock *);
     void collect_store_not_critical(ir::Function *);
+    bool collect_array_access(ir::Value *ptr,
+                              std::vector<ir::Instruction *> &stores,
+                              std::vector<ir::Instruction *> &loads);
 
     const pass::FuncInfo::ResultType *_func_info;
+    const pass::AliasAnalysis::ResultType *_alias;
+    const pass::PostDomTree *_post_dom;
+    pass::Dominator::ResultType *_dom;
+    pass::CallGraph::ResultType *_call_graph;
 
+    const bool aggressive;
     bool changed;
     std::deque<ir::Instruction *> work_list{};
     std::unordered_map<ir::Instruction *, bool> marked{};
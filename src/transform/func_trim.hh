@@ -1,5 +1,6 @@
 #pragma once
 
+#include "call_graph.hh"
 #include "dead_code.hh"
 #include "function.hh"
 #include "instruction.hh"
@@ -15,6 +16,8 @@ class FuncTrim final : public TransformPass {
     FuncTrim() = default;
     virtual void get_analysis_usage(pass::AnalysisUsage &AU) const override {
         TransformPass::get_analysis_usage(AU);
+        // only the types of the calls change
+        AU.add_preserve<pass::CallGraph>();
         AU.add_post<pass::DeadCode>();
     }
     bool run(pass::PassManager *mgr) override {
@@ -101,7 +101,17 @@ void GlobalVarLocalize::prop_const(GlobalVariable *global_var) {
         if (idxs.size() + 1 != gep->operands().size())
             continue;
         assert(idxs.size() == 1 + arr_type->get_dims());
-        assert(idxs[0] == 0);
+        // out of bounds, which is left in the code never run, e.g. after a
+        // branch is folded by the ranges
+        bool in_bounds = idxs[0] == 0;
+        Type *type = arr_type;
+        for (unsigned i = 1; i < idxs.size(); ++i) {
+            auto cnt = type->as<ArrayType>()->get_elem_cnt();
+            in_bounds &= idxs[i] >= 0 and static_cast<size_t>(idxs[i]) < cnt;
+            type = type->as<ArrayType>()->get_elem_type();
+        }
+        if (not in_bounds)
+            continue;
         // find corresponding init value
         bool zero_init = false;
         auto init = global_var->get_init();
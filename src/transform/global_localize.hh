@@ -2,6 +2,7 @@
 
 #include "const_propagate.hh"
 #include "dead_code.hh"
+#include "dominator.hh"
 #include "function.hh"
 #include "global_variable.hh"
 #include "mem2reg.hh"
@@ -21,6 +22,7 @@ class GlobalVarLocalize : public TransformPass {
     virtual void get_analysis_usage(AnalysisUsage &AU) const override {
         using KillType = AnalysisUsage::KillType;
         AU.set_kill_type(KillType::All);
+        AU.add_preserve<Dominator>();
         if (NeedMem2reg)
             AU.add_post<Mem2reg>();
         if (NeedConstPro)
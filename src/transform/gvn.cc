@@ -8,6 +8,7 @@
 #include "function.hh"
 #include "global_variable.hh"
 #include "instruction.hh"
+#include "remark.hh"
 
 #include "type.hh"
 #include "utils.hh"
@@ -77,6 +78,8 @@ bool GVN::CongruenceClass::operator==(const CongruenceClass &other) const {
 bool GVN::run(PassManager *mgr) {
     _func_info = &mgr->get_result<FuncInfo>();
     _depth_order = &mgr->get_result<DepthOrder>();
+    _alias = &mgr->get_result<AliasAnalysis>();
+    _mssa = &mgr->get_result<MemorySSA>();
     clear();
     auto m = mgr->get_module();
     for (auto &gv : m->global_vars()) {
@@ -94,6 +97,7 @@ bool GVN::run(PassManager *mgr) {
         }
         detect_equivalences(&f);
         replace_cc_members();
+        report_missed_loads(&f);
     }
     return false;
 }
@@ -375,8 +379,7 @@ shared_ptr<GVN::Expression> GVN::valueExpr(Value *val, partitions &pin) {
                ::is_a<SextInst>(val)) {
         ve = create_expr<UniqueExpr>(val);
     } else if (::is_a<LoadInst>(val)) {
-        ve = create_expr<LoadExpr>(
-            valueExpr(::as_a<LoadInst>(val)->get_operand(0), pin));
+        ve = load_expr(::as_a<LoadInst>(val), pin);
     } else if (::is_a<StoreInst>(val)) {
         ve = create_expr<StoreExpr>(
             valueExpr(::as_a<StoreInst>(val)->get_operand(0), pin),
@@ -468,39 +471,90 @@ void GVN::replace_cc_members() {
     for (auto &[bb_r, part] : non_copy_pout) { // if it is a copy statement, it
                                                // shouldn't replace any inst
         auto bb = bb_r;
+        auto use_in_bb = [bb](const Use &use) -> bool {
+            if (auto inst = dynamic_cast<Instruction *>(use.user)) {
+                auto parent = inst->get_parent();
+                if (::is_a<PhiInst>(inst))
+                    return inst->get_operand(use.op_idx + 1) ==
+                           bb; // only replace the
+                               // operand of the
+                               // user from current
+                               // bb for phi
+                else
+                    return parent == bb; // replace the members
+                                         // if users are in the
+                                         // same block as bb
+            }
+            return false;
+        };
         for (auto &cc : part) {
             if (cc->index == 0)
                 continue;
             for (auto &member : cc->members) {
                 if (member != cc->leader and not ::is_a<Constant>(member)) {
                     assert(cc->leader);
+                    auto &uses = member->get_use_list();
+                    bool used_in_bb =
+                        any_of(uses.begin(), uses.end(), use_in_bb);
                     if (::is_a<PhiInst>(cc->leader) &&
                         ::is_a<PhiInst>(member) &&
                         ::as_a<PhiInst>(member)->get_parent() !=
                             ::as_a<PhiInst>(cc->leader)->get_parent()) {
+                        if (used_in_bb)
+                            RemarkEmitter::get().missed(
+                                PASS_NAME, "PhiInOtherBlock", bb,
+                                member->get_name() + " is congruent to " +
+                                    cc->leader->get_name() +
+                                    " but the phis live in different blocks");
                         continue;
                     }
-                    member->replace_all_use_with_if(
-                        cc->leader, [bb](const Use &use) -> bool {
-                            if (auto inst =
-                                    dynamic_cast<Instruction *>(use.user)) {
-                                auto parent = inst->get_parent();
-                                if (::is_a<PhiInst>(inst))
-                                    return inst->get_operand(use.op_idx + 1) ==
-                                           bb; // only replace the
-                                               // operand of the
-                                               // user from current
-                                               // bb for phi
-                                else
-                                    return parent == bb; // replace the members
-                                                         // if users are in the
-                                                         // same block as bb
-                            }
-                            return false;
-                        });
+                    if (used_in_bb)
+                        RemarkEmitter::get().applied(
+                            PASS_NAME, "Replaced", bb,
+                            member->get_name() + " replaced by " +
+                                cc->leader->get_name());
+                    member->replace_all_use_with_if(cc->leader, use_in_bb);
                 }
             }
         }
     }
     return;
 }
+
+void GVN::report_missed_loads(Function *func) {
+    auto &remarks = RemarkEmitter::get();
+    if (not remarks.enabled(RemarkEmitter::Kind::Missed, PASS_NAME))
+        return;
+    for (auto &bb : func->bbs()) {
+        for (auto &inst : bb.insts()) {
+            if (not ::is_a<LoadInst>(&inst))
+                continue;
+            auto clobber =
+                _mssa->get_clobbering_access(::as_a<LoadInst>(&inst));
+            if (clobber and clobber->kind == MemoryAccess::Phi) {
+                remarks.missed(PASS_NAME, "LoadClobberedByPhi", &bb,
+                               "load " + inst.get_name() +
+                                   " may be written on some path into " +
+                                   clobber->bb->get_name() +
+                                   ", it is not numbered with the loads "
+                                   "before that");
+            }
+        }
+    }
+}
+
+/* a load reading what a store just wrote is the stored value, otherwise it is
+ * numbered by its address and the memory state it reads
+ */
+shared_ptr<GVN::Expression> GVN::load_expr(LoadInst *load, partitions &pin) {
+    auto clobber = _mssa->get_clobbering_access(load);
+    if (clobber == nullptr)
+        return create_expr<UniqueExpr>(load);
+    if (clobber->kind == MemoryAccess::Def and
+        ::is_a<StoreInst>(clobber->inst)) {
+        auto store = ::as_a<StoreInst>(clobber->inst);
+        if (_alias->alias(store->ptr(), load->ptr()) == AliasResult::MustAlias)
+            return valueExpr(store->val(), pin);
+    }
+    return create_expr<LoadExpr>(valueExpr(load->ptr(), pin), clobber);
+}
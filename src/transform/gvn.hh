@@ -1,4 +1,5 @@
 #pragma once
+#include "alias_analysis.hh"
 #include "basic_block.hh"
 #include "constant.hh"
 #include "dead_code.hh"
@@ -6,9 +7,13 @@
 #include "func_info.hh"
 #include "instruction.hh"
 #include "mem2reg.hh"
+#include "memory_ssa.hh"
 #include "pass.hh"
+#include "reg_pressure.hh"
+#include "scalar_evolution.hh"
 #include "utils.hh"
 #include "value.hh"
+#include "value_range.hh"
 #include <cassert>
 #include <cstddef>
 #include <list>
@@ -17,8 +22,7 @@
 #include <utility>
 #include <vector>
 
-// TODO:analysis of MemAddress use chain
-// improve efficiency of GVN
+// TODO: improve efficiency of GVN
 
 namespace pass {
 
@@ -30,6 +34,12 @@ class GVN final : public pass::TransformPass {
         AU.set_kill_type(KillType::Normal);
         AU.add_require<FuncInfo>();
         AU.add_require<DepthOrder>();
+        AU.add_require<AliasAnalysis>();
+        AU.add_require<MemorySSA>();
+        AU.add_kill<ScalarEvolution>();
+        AU.add_kill<MemorySSA>();
+        AU.add_kill<ValueRange>();
+        AU.add_kill<RegPressure>();
         AU.add_post<DeadCode>();
     }
     virtual bool run(pass::PassManager *mgr) override;
@@ -190,13 +200,15 @@ class GVN final : public pass::TransformPass {
         ir::Instruction *_inst{};
         std::vector<std::shared_ptr<Expression>> _params{};
     };
+    // _mem is the memory state the load reads, i.e. its clobbering access in
+    // MemorySSA, so that loads in different bbs are numbered as well
     class LoadExpr final : public Expression {
       public:
-        LoadExpr(std::shared_ptr<Expression> addr)
-            : Expression(expr_type::e_load), _addr(addr) {}
+        LoadExpr(std::shared_ptr<Expression> addr, const MemoryAccess *mem)
+            : Expression(expr_type::e_load), _addr(addr), _mem(mem) {}
 
         bool operator==(const LoadExpr &other) const {
-            return false && *_addr == *other._addr;
+            return _mem == other._mem && *_addr == *other._addr;
         }
 
         virtual std::string print() {
@@ -205,6 +217,7 @@ class GVN final : public pass::TransformPass {
 
       private:
         std::shared_ptr<Expression> _addr;
+        const MemoryAccess *_mem;
     };
 
     class StoreExpr final : public Expression {
@@ -487,6 +500,8 @@ class GVN final : public pass::TransformPass {
 
     // replace the members of the same CongruemceClass with the first value
     void replace_cc_members();
+    void report_missed_loads(ir::Function *);
+    std::shared_ptr<Expression> load_expr(ir::LoadInst *, partitions &);
 
     // utils function
     std::shared_ptr<Expression> get_ve(ir::Value *, partitions &);
@@ -521,11 +536,15 @@ class GVN final : public pass::TransformPass {
     }
 
   private:
+    static constexpr auto PASS_NAME = "gvn";
+
     partitions TOP{create_cc(0)};
     ir::Function *_func;
     ir::BasicBlock *_bb;
     const pass::FuncInfo::ResultType *_func_info;
     const pass::DepthOrder::ResultType *_depth_order;
+    const pass::AliasAnalysis::ResultType *_alias;
+    const pass::MemorySSA::ResultType *_mssa;
     std::map<ir::BasicBlock *, partitions> _pin, _pout;
 
     // helper members which can improve analysis efficiency
@@ -22,13 +22,14 @@ inline bool InductionExpr::is_induction_expr(Instruction *inst) {
 bool InductionExpr::run(pass::PassManager *mgr) {
     auto m = mgr->get_module();
     _func_loops = &mgr->get_result<LoopFind>();
+    _scev = &mgr->get_result<ScalarEvolution>();
     changed = false;
     replace_table.clear();
     for (auto &f_r : m->functions()) {
         for (auto &bb_r : f_r.bbs()) {
             for (auto &inst_r : bb_r.insts()) {
                 if (is_induction_expr(&inst_r)) {
-                    if (get_iter_times(&inst_r) == nullptr) {
+                    if (not _scev->trip_count(&bb_r).has_value()) {
                         continue;
                     }
                     for (auto &use : inst_r.get_use_list()) {
@@ -79,7 +80,7 @@ Value *InductionExpr::induce_add_rem(ir::Instruction *expr,
         add = as_a<IBinaryInst>(r_val)->get_operand(0)->as<Instruction>();
     } else
         return nullptr;
-    auto iter_times = get_iter_times(expr);
+    auto iter_times = get_iter_times(expr, user);
     auto init_m = user->get_parent()->insert_inst<IBinaryInst>(
         user, IBinaryInst::SREM, init_val, rem);
     auto iter_m = user->get_parent()->insert_inst<IBinaryInst>(
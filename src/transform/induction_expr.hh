@@ -2,10 +2,14 @@
 #include "basic_block.hh"
 #include "instruction.hh"
 #include "loop_find.hh"
+#include "memory_ssa.hh"
 #include "pass.hh"
+#include "reg_pressure.hh"
 #include "rm_useless_loop.hh"
+#include "scalar_evolution.hh"
 #include "user.hh"
 #include "value.hh"
+#include "value_range.hh"
 #include <map>
 #include <utility>
 
@@ -19,6 +23,11 @@ class InductionExpr final : public pass::TransformPass {
         using KillType = pass::AnalysisUsage::KillType;
         AU.set_kill_type(KillType::Normal);
         AU.add_require<LoopFind>();
+        AU.add_require<ScalarEvolution>();
+        AU.add_kill<ScalarEvolution>();
+        AU.add_kill<MemorySSA>();
+        AU.add_kill<ValueRange>();
+        AU.add_kill<RegPressure>();
         AU.add_post<RmUselessLoop>();
     }
 
@@ -35,47 +44,23 @@ class InductionExpr final : public pass::TransformPass {
     // require loop_find to give these interfaces as follow
     // judge whether a bb is a loop head
     bool is_loop_head(ir::BasicBlock *bb) {
-        return _func_loops->loop_info.at(bb->get_func()).loops.find(bb) !=
-               _func_loops->loop_info.at(bb->get_func()).loops.end();
+        return _func_loops->loop_info.at(bb->get_func()).is_header(bb);
     }
 
     // judge whether user is out of the loop of loop_head
     bool out_of_loop(ir::BasicBlock *user, ir::BasicBlock *loop_head) {
-        return not contains(_func_loops->loop_info.at(loop_head->get_func())
-                                .loops.at(loop_head)
-                                .bbs,
-                            user);
+        return not _func_loops->loop_info.at(loop_head->get_func())
+                       .in_loop(user, loop_head);
     }
 
-    // calculate the iter times of a loop
-    ir::Value *get_iter_times(ir::Instruction *expr) {
-        auto cal_iter_times =
-            [&](const LoopFind::ResultType::LoopInfo::IndVarInfo &ind_var_info)
-            -> ir::Value * {
-            if (not ind_var_info.initial->is<ir::ConstInt>() or
-                ind_var_info.initial->as<ir::ConstInt>()->val() != 0) {
-                return nullptr;
-            }
-            if (ind_var_info.icmp_op != ir::ICmpInst::ICmpOp::LT) {
-                return nullptr;
-            }
-            if (not ind_var_info.step->is<ir::ConstInt>() or
-                ind_var_info.step->as<ir::ConstInt>()->val() != 1) {
-                return nullptr;
-            }
-            return ind_var_info.bound;
-        };
-        for (auto &&[func, loops] : _func_loops->loop_info) {
-            for (auto &&[header, loop] : loops.loops) {
-                if (contains(loop.bbs, expr->get_parent())) {
-                    if (not loop.ind_var_info.has_value()) {
-                        return nullptr;
-                    }
-                    return cal_iter_times(loop.ind_var_info.value());
-                }
-            }
+    // calculate the iter times of the loop whose header defines expr, the
+    // insts are inserted before pos
+    ir::Value *get_iter_times(ir::Instruction *expr, ir::Instruction *pos) {
+        auto iter_times = _scev->trip_count(expr->get_parent());
+        if (not iter_times.has_value()) {
+            return nullptr;
         }
-        throw unreachable_error{};
+        return _scev->expand(iter_times.value(), pos);
     }
 
   private:
@@ -84,6 +69,7 @@ class InductionExpr final : public pass::TransformPass {
     std::map<ir::Value *, std::pair<ir::User *, unsigned>> replace_table;
 
     const LoopFind::ResultType *_func_loops;
+    const ScalarEvolution::ResultType *_scev;
 };
 
 }; // namespace pass
@@ -2,6 +2,7 @@
 #include "depth_order.hh"
 #include "function.hh"
 #include "instruction.hh"
+#include "remark.hh"
 #include "type.hh"
 #include "utils.hh"
 #include <cassert>
@@ -18,8 +19,32 @@ bool Inline::is_inline(Function *func) {
     return true;
 }
 
+// inlining a callee with loops is worth nothing if the values live across
+// the call are then spilled in its loops, the call overhead is paid once
+bool Inline::over_budget(Instruction *call) {
+    auto callee = as_a<Function>(call->get_operand(0));
+    if (_loops->loop_info.at(callee).loops.empty())
+        return false;
+    if (not _caller_pressure.has_value()) {
+        _caller_pressure.emplace();
+        _caller_pressure->build(call->get_parent()->get_func());
+    }
+    auto it = _callee_pressure.find(callee);
+    if (it == _callee_pressure.end()) {
+        PressureInfo info;
+        info.build(callee);
+        it = _callee_pressure.insert({callee, info.max()}).first;
+    }
+    return not(_caller_pressure->live_across(call) + it->second).fits();
+}
+
 bool Inline::run(PassManager *mgr) {
     auto m = mgr->get_module();
+    _dom = mgr->get_result_if_valid<Dominator>();
+    _call_graph = mgr->get_result_if_valid<CallGraph>();
+    _loops = &mgr->get_result<LoopFind>();
+    _callee_pressure.clear();
+    _over_budget.clear();
     const unsigned upper_times = 5; // set iter_expanded upper times
     deque<Instruction *> call_work_list{};
     unsigned iter_times = 0;
@@ -29,12 +54,32 @@ bool Inline::run(PassManager *mgr) {
             main_func = &f_r;
     }
     while (iter_times++ < upper_times) { // find which call can be expanded
+        // main changes in each round
+        _caller_pressure.reset();
         for (auto &bb_r : main_func->bbs()) {
             for (auto iter = bb_r.insts().begin(); iter != bb_r.insts().end();
                  ++iter) {
-                if (is_a<CallInst>(&*iter) &&
-                    is_inline(as_a<Function>(iter->get_operand(0)))) {
+                if (not is_a<CallInst>(&*iter))
+                    continue;
+                auto callee = as_a<Function>(iter->get_operand(0));
+                if (contains(_over_budget, &*iter)) {
+                    continue;
+                } else if (is_inline(callee) and over_budget(&*iter)) {
+                    _over_budget.insert(&*iter);
+                    RemarkEmitter::get().missed(
+                        PASS_NAME, "RegisterPressure", &bb_r,
+                        callee->get_name() + " will not be inlined into " +
+                            main_func->get_name() +
+                            " because its loops would spill the values "
+                            "live across the call");
+                } else if (is_inline(callee)) {
                     call_work_list.push_back(&*iter);
+                } else {
+                    RemarkEmitter::get().missed(
+                        PASS_NAME, "NoDefinition", &bb_r,
+                        callee->get_name() + " will not be inlined into " +
+                            main_func->get_name() +
+                            " because its definition is unavailable");
                 }
             }
         }
@@ -43,11 +88,34 @@ bool Inline::run(PassManager *mgr) {
         while (not call_work_list.empty()) {
             auto top = call_work_list.front();
             call_work_list.pop_front();
+            RemarkEmitter::get().applied(
+                PASS_NAME, "Inlined", top->get_parent(),
+                top->get_operand(0)->get_name() + " inlined into " +
+                    main_func->get_name());
             clee2cler.clear();
             inline_bb.clear();
             inline_func(top);
         }
     }
+    assert(_call_graph->verify());
+    // calls exposed by the last round are left as is
+    auto &remarks = RemarkEmitter::get();
+    if (not remarks.enabled(RemarkEmitter::Kind::Missed, PASS_NAME))
+        return false;
+    for (auto &bb_r : main_func->bbs()) {
+        for (auto &inst_r : bb_r.insts()) {
+            if (is_a<CallInst>(&inst_r) &&
+                is_inline(as_a<Function>(inst_r.get_operand(0))) &&
+                not contains(_over_budget, &inst_r)) {
+                remarks.missed(PASS_NAME, "TooDeep", &bb_r,
+                               inst_r.get_operand(0)->get_name() +
+                                   " will not be inlined into " +
+                                   main_func->get_name() +
+                                   " because the inline depth limit " +
+                                   to_string(upper_times) + " is reached");
+            }
+        }
+    }
     return false;
 }
 
@@ -89,6 +157,8 @@ void Inline::clone(Function *callee, Function *caller) {
             auto map_inst =
                 map_bb->clone_inst(map_bb->insts().end(), inst, true);
             clee2cler[inst] = map_inst;
+            if (is_a<CallInst>(map_inst))
+                _call_graph->add_call(as_a<CallInst>(map_inst));
         }
     }
 }
@@ -126,6 +196,7 @@ void Inline::trivial(InstIter call_iter) {
     map_exit_bb->erase_inst(&map_exit_bb->insts().back());
     // step2 move insts after call_inst from parent_bb to map_exit_bb
     auto parent_bb = call_iter->get_parent();
+    auto parent_sucs = parent_bb->suc_bbs();
     auto move_iter = call_iter;
     // count which instructions need to be moved
     list<Instruction *> move_insts;
@@ -150,6 +221,17 @@ void Inline::trivial(InstIter call_iter) {
     }
     // step3 replace call_inst with a jump inst to map_entry_bb
     auto map_entry_bb = as_a<BasicBlock>(clee2cler[callee->get_entry_bb()]);
+    _call_graph->remove_call(as_a<CallInst>(&*call_iter));
     parent_bb->erase_inst(&*call_iter);
     parent_bb->create_inst<BrInst>(map_entry_bb);
+    // step4 update the dominator tree, the cloned bbs are found by itself
+    if (_dom) {
+        using Update = DomTree::Update;
+        vector<Update> updates{{Update::Insert, parent_bb, map_entry_bb}};
+        for (auto suc : parent_sucs) {
+            updates.push_back({Update::Delete, parent_bb, suc});
+            updates.push_back({Update::Insert, map_exit_bb, suc});
+        }
+        _dom->at(parent_bb->get_func()).apply_updates(updates);
+    }
 }
@@ -1,16 +1,22 @@
 #pragma once
+#include "call_graph.hh"
 #include "const_propagate.hh"
 #include "dead_code.hh"
 #include "depth_order.hh"
+#include "dominator.hh"
 #include "function.hh"
 #include "global_localize.hh"
 #include "ilist.hh"
 #include "instruction.hh"
+#include "loop_find.hh"
 #include "loop_invariant.hh"
 #include "pass.hh"
+#include "reg_pressure.hh"
 #include "remove_unreach_bb.hh"
 #include "value.hh"
 #include <deque>
+#include <optional>
+#include <set>
 #include <unordered_map>
 
 namespace pass {
@@ -25,6 +31,10 @@ class Inline final : public pass::TransformPass {
         using KillType = pass::AnalysisUsage::KillType;
         AU.set_kill_type(KillType::All);
         AU.add_require<DepthOrder>();
+        AU.add_require<CallGraph>();
+        AU.add_require<LoopFind>();
+        AU.add_preserve<Dominator>();
+        AU.add_preserve<CallGraph>();
         AU.add_post<DeadCode>();
         AU.add_post<GlobalVarLocalize>();
         AU.add_post<ConstPro>();
@@ -33,13 +43,25 @@ class Inline final : public pass::TransformPass {
     virtual bool run(pass::PassManager *mgr) override;
 
   private:
+    static constexpr auto PASS_NAME = "inline";
+
     bool is_inline(ir::Function *);
+    bool over_budget(ir::Instruction *call);
     void inline_func(InstIter);
     void clone(ir::Function *, ir::Function *);
     void replace(InstIter);
     void trivial(InstIter);
     std::unordered_map<const ir::Value *, ir::Value *> clee2cler;
     std::deque<ir::BasicBlock *> inline_bb;
+    Dominator::ResultType *_dom;
+    CallGraph::ResultType *_call_graph;
+    const LoopFind::ResultType *_loops;
+    // built on the first call to a callee with loops in each round
+    std::optional<PressureInfo> _caller_pressure;
+    // the max pressure in each callee
+    std::unordered_map<ir::Function *, Pressure> _callee_pressure;
+    // the calls left for the register pressure
+    std::set<ir::Instruction *> _over_budget;
 };
 
 }; // namespace pass
@@ -2,8 +2,12 @@
 #include "depth_order.hh"
 #include "hash.hh"
 #include "instruction.hh"
+#include "memory_ssa.hh"
 #include "pass.hh"
+#include "reg_pressure.hh"
+#include "scalar_evolution.hh"
 #include "value.hh"
+#include "value_range.hh"
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -16,6 +20,10 @@ class LocalCmnExpr final : public pass::TransformPass {
     virtual void get_analysis_usage(pass::AnalysisUsage &AU) const override {
         using KillType = pass::AnalysisUsage::KillType;
         AU.add_require<DepthOrder>();
+        AU.add_kill<ScalarEvolution>();
+        AU.add_kill<MemorySSA>();
+        AU.add_kill<ValueRange>();
+        AU.add_kill<RegPressure>();
         AU.set_kill_type(KillType::Normal);
     }
     virtual bool run(pass::PassManager *mgr) override;
@@ -1,6 +1,8 @@
 #include "loop_invariant.hh"
 #include "dominator.hh"
 #include "log.hh"
+#include "remark.hh"
+#include <algorithm>
 
 using namespace pass;
 using namespace ir;
@@ -14,112 +16,122 @@ bool LoopInvariant::is_invariant_operand(Value *op, const LoopInfo &loop) {
     return not contains(loop.bbs, inst->get_parent());
 }
 
-bool LoopInvariant::is_dom_store(Instruction *inst, const LoopInfo &loop) {
-    if (not inst->is<StoreInst>()) {
-        return false;
-    }
-
-    auto get_gep_base = [](Instruction *inst) {
-        Value *ptr{nullptr};
-        if (inst->is<LoadInst>()) {
-            ptr = inst->as<LoadInst>()->ptr();
-        } else if (inst->is<StoreInst>()) {
-            ptr = inst->as<StoreInst>()->ptr();
-        } else {
-            throw unreachable_error{};
-        }
-        if (not ptr->is<GetElementPtrInst>()) {
-            return ptr;
-        }
-        auto gep = ptr->as<GetElementPtrInst>();
-        while (true) {
-            if (not gep->base_ptr()->is<GetElementPtrInst>()) {
-                return gep->base_ptr();
+vector<Instruction *> LoopInvariant::collect_writers(const LoopInfo &loop) {
+    vector<Instruction *> ret;
+    for (auto bb : loop.bbs) {
+        for (auto &&inst : bb->insts()) {
+            if (inst.is<StoreInst>() or inst.is<CallInst>()) {
+                ret.push_back(&inst);
             }
-            gep = gep->base_ptr()->as<GetElementPtrInst>();
         }
-        throw unreachable_error{};
-    };
+    }
+    return ret;
+}
 
-    auto may_alias = [&](Instruction *other) {
-        if (other->is<CallInst>()) {
-            return true;
-        }
-        if (not(other->is<LoadInst>() or other->is<StoreInst>())) {
+bool LoopInvariant::is_clobbered(const MemLoc &loc,
+                                 const vector<Instruction *> &writers) {
+    return any_of(writers.begin(), writers.end(), [&](Instruction *writer) {
+        return is_mod(_alias->get_mod_ref(writer, loc));
+    });
+}
+
+// bb runs whenever the loop is entered, if it dominates all exiting bbs
+bool LoopInvariant::is_guaranteed_to_execute(BasicBlock *bb,
+                                             const LoopInfo &loop) {
+    if (loop.exits.empty()) {
+        return false;
+    }
+    for (auto &&[exiting, _] : loop.exits) {
+        if (not _dom->dominates(bb, exiting)) {
             return false;
         }
-        auto inst_base = get_gep_base(inst);
-        auto other_base = get_gep_base(other);
-        if (inst_base->is<AllocaInst>() and other_base->is<AllocaInst>()) {
-            return inst_base == other_base;
-        }
-        return true;
-    };
+    }
+    return true;
+}
 
-    bool dom_in_bb{true};
-    for (auto &&other : inst->get_parent()->insts()) {
-        if (&other == inst) {
-            break;
-        }
-        if (may_alias(&other)) {
-            dom_in_bb = false;
-            break;
-        }
+// the geps in the loop computing an invariant ptr are pushed to geps, bases
+// first
+bool LoopInvariant::is_invariant_addr(Value *ptr, const LoopInfo &loop,
+                                      vector<Instruction *> &geps) {
+    if (is_invariant_operand(ptr, loop)) {
+        return true;
     }
-    bool dom_out_bb{true};
-    auto cur_bb = inst->get_parent();
-    for (auto &&bb : loop.bbs) {
-        if (_dom->is_dom(cur_bb, bb)) {
-            continue;
-        }
-        for (auto &&other : bb->insts()) {
-            if (may_alias(&other)) {
-                dom_out_bb = false;
-                break;
-            }
+    if (not ptr->is<GetElementPtrInst>()) {
+        return false;
+    }
+    auto gep = ptr->as<GetElementPtrInst>();
+    for (unsigned i = 1; i < gep->operands().size(); ++i) {
+        if (not is_invariant_operand(gep->get_operand(i), loop)) {
+            return false;
         }
     }
-    return dom_in_bb and dom_out_bb;
+    if (not is_invariant_addr(gep->base_ptr(), loop, geps)) {
+        return false;
+    }
+    geps.push_back(gep);
+    return true;
 }
 
-vector<Instruction *> LoopInvariant::collect_gep_store(BasicBlock *bb,
-                                                       const LoopInfo &loop) {
+// a load is hoisted with its address if nothing in the loop may write to it,
+// and it is either executed anyway or safe to speculate
+vector<Instruction *>
+LoopInvariant::collect_invariant_load(BasicBlock *bb, const LoopInfo &loop,
+                                      const vector<Instruction *> &writers) {
     vector<Instruction *> ret;
     for (auto &&inst : bb->insts()) {
-        if (not inst.is<StoreInst>()) {
+        if (not inst.is<LoadInst>()) {
             continue;
         }
-
-        auto store = inst.as<StoreInst>();
-        if (not is_invariant_operand(store->val(), loop)) {
+        auto load = inst.as<LoadInst>();
+        vector<Instruction *> geps;
+        if (not is_invariant_addr(load->ptr(), loop, geps)) {
             continue;
         }
-        if (not is_dom_store(store, loop)) {
+        auto loc = AliasAnalysis::ResultType::location(load->ptr());
+        if (is_clobbered(loc, writers)) {
             continue;
         }
-        if (store->ptr()->is<GetElementPtrInst>()) {
-            auto gep = store->ptr()->as<GetElementPtrInst>();
-            bool gep_op_invariant{true};
-            for (auto &&op : gep->operands()) {
-                if (not is_invariant_operand(op, loop)) {
-                    gep_op_invariant = false;
-                    break;
-                }
-            }
-            if (not gep_op_invariant) {
-                continue;
-            }
-            ret.push_back(gep);
-            ret.push_back(store);
-        } else if (store->ptr()->is<AllocaInst>()) {
-            if (is_invariant_operand(store->ptr(), loop)) {
-                ret.push_back(store);
-            }
+        if (not is_guaranteed_to_execute(bb, loop) and
+            not _alias->is_dereferenceable(loc)) {
+            continue;
         }
+        ret.insert(ret.end(), geps.begin(), geps.end());
+        ret.push_back(load);
     }
     return ret;
 }
 
+// an inst no more costly to run in each iteration than to reload after a spill
+bool LoopInvariant::is_cheap(Instruction *inst) {
+    if (inst->is<IBinaryInst>()) {
+        auto op = inst->as<IBinaryInst>()->get_ibin_op();
+        return op != IBinaryInst::MUL and op != IBinaryInst::SDIV and
+               op != IBinaryInst::SREM;
+    }
+    return inst->is<ICmpInst>() or inst->is<ZextInst>() or
+           inst->is<SextInst>() or inst->is<TruncInst>() or
+           inst->is<Ptr2IntInst>() or inst->is<Int2PtrInst>();
+}
+
+// the registers taken through the loop by hoisting inst, none if it is the
+// last use in the loop of an operand in the same kind of registers
+Pressure LoopInvariant::hoist_cost(Instruction *inst, const LoopInfo &loop) {
+    auto cost = PressureInfo::of(inst);
+    for (auto op : inst->operands()) {
+        auto op_cost = PressureInfo::of(op);
+        if (op_cost.ints != cost.ints or op_cost.floats != cost.floats)
+            continue;
+        auto &uses = op->get_use_list();
+        if (all_of(uses.begin(), uses.end(), [&](auto &use) {
+                auto user = as_a<Instruction>(use.user);
+                return user == inst or
+                       not contains(loop.bbs, user->get_parent());
+            }))
+            return {};
+    }
+    return cost;
+}
+
 bool LoopInvariant::is_side_effect_inst(Instruction *inst) {
     return inst->is<LoadInst>() || inst->is<StoreInst>() ||
            inst->is<CallInst>() || inst->is<RetInst>() || inst->is<BrInst>() ||
@@ -148,22 +160,57 @@ LoopInvariant::collect_invariant_inst(BasicBlock *bb, const LoopInfo &loop) {
 }
 
 void LoopInvariant::handle_func(Function *func, const FuncLoopInfo &func_loop) {
-    for (auto &&header : func_loop.get_topo_order()) {
+    for (auto &&header : func_loop.preorder) {
         auto &&loop = func_loop.loops.at(header);
         assert(loop.preheader != nullptr);
         auto preheader = loop.preheader;
         bool changed{true};
+        vector<Instruction *> kept;
         while (changed) {
             vector<Instruction *> insts;
+            auto writers = collect_writers(loop);
             for (auto bb : loop.bbs) {
                 auto bb_insts = collect_invariant_inst(bb, loop);
                 insts.insert(insts.end(), bb_insts.begin(), bb_insts.end());
+                auto bb_loads = collect_invariant_load(bb, loop, writers);
+                insts.insert(insts.end(), bb_loads.begin(), bb_loads.end());
             }
-            changed = insts.size() > 0;
+            changed = false;
             for (auto inst : insts) {
+                // a gep shared by several loads is collected more than once
+                if (inst->get_parent() == preheader) {
+                    continue;
+                }
+                auto cost = hoist_cost(inst, loop);
+                if (is_cheap(inst) and cost.ints + cost.floats > 0 and
+                    not(_pressure->loop(header) + _extra[header] + cost)
+                           .fits()) {
+                    if (not contains(kept, inst))
+                        kept.push_back(inst);
+                    continue;
+                }
+                // the value is live through the loops nested in it as well
+                for (auto inner : func_loop.preorder) {
+                    if (func_loop.nested_in(inner, header))
+                        _extra[inner] = _extra[inner] + cost;
+                }
+                changed = true;
+                RemarkEmitter::get().applied(
+                    PASS_NAME, "Hoisted", inst->get_parent(),
+                    inst->get_name() + " hoisted to preheader " +
+                        preheader->get_name());
                 preheader->move_inst(&*preheader->insts().rbegin(), inst);
             }
         }
+        for (auto inst : kept) {
+            if (inst->get_parent() == preheader)
+                continue;
+            RemarkEmitter::get().missed(
+                PASS_NAME, "RegisterPressure", inst->get_parent(),
+                inst->get_name() +
+                    " is cheaper to recompute than to spill, not hoisted");
+        }
+        report_missed(loop);
 
         /* debugs << "invariant of loop " << header->get_name();
          * for (auto &&inst : preheader->insts()) {
@@ -173,9 +220,61 @@ void LoopInvariant::handle_func(Function *func, const FuncLoopInfo &func_loop) {
     }
 }
 
+void LoopInvariant::report_missed(const LoopInfo &loop) {
+    auto &remarks = RemarkEmitter::get();
+    if (not remarks.enabled(RemarkEmitter::Kind::Missed, PASS_NAME))
+        return;
+    auto writers = collect_writers(loop);
+    for (auto bb : loop.bbs) {
+        for (auto &&inst : bb->insts()) {
+            if (not(inst.is<LoadInst>() or inst.is<GetElementPtrInst>() or
+                    inst.is<CallInst>())) {
+                continue;
+            }
+            bool invariant{true};
+            for (auto &&op : inst.operands()) {
+                if (not is_invariant_operand(op, loop)) {
+                    invariant = false;
+                    break;
+                }
+            }
+            if (not invariant) {
+                continue;
+            }
+            if (inst.is<LoadInst>() and
+                is_clobbered(AliasAnalysis::ResultType::location(
+                                 inst.as<LoadInst>()->ptr()),
+                             writers)) {
+                remarks.missed(PASS_NAME, "LoadClobbered", bb,
+                               "load " + inst.get_name() +
+                                   " has invariant address but may be "
+                                   "clobbered inside the loop");
+            } else if (inst.is<LoadInst>()) {
+                remarks.missed(PASS_NAME, "LoadNotSpeculated", bb,
+                               "load " + inst.get_name() +
+                                   " may not run in every iteration and is "
+                                   "unsafe to speculate");
+            } else if (inst.is<CallInst>()) {
+                remarks.missed(PASS_NAME, "CallNotHoisted", bb,
+                               "call to " + inst.get_operand(0)->get_name() +
+                                   " has invariant arguments but calls "
+                                   "are never hoisted");
+            } else {
+                remarks.missed(PASS_NAME, "GEPNotHoisted", bb,
+                               "gep " + inst.get_name() +
+                                   " has invariant operands but geps are "
+                                   "only hoisted along with loads");
+            }
+        }
+    }
+}
+
 bool LoopInvariant::run(PassManager *mgr) {
     auto &&loop_info = mgr->get_result<LoopFind>().loop_info;
     _dom = &mgr->get_result<Dominator>();
+    _alias = &mgr->get_result<AliasAnalysis>();
+    _pressure = &mgr->get_result<RegPressure>();
+    _extra.clear();
     auto m = mgr->get_module();
     for (auto &&func : m->functions()) {
         if (func.is_external) {
@@ -1,9 +1,12 @@
 #pragma once
 
+#include "alias_analysis.hh"
 #include "dominator.hh"
 #include "loop_find.hh"
 #include "loop_simplify.hh"
 #include "pass.hh"
+#include "reg_pressure.hh"
+#include <unordered_map>
 
 namespace pass {
 
@@ -15,6 +18,9 @@ class LoopInvariant final : public TransformPass {
         AU.add_require<LoopSimplify>();
         AU.add_require<LoopFind>();
         AU.add_require<Dominator>();
+        AU.add_require<AliasAnalysis>();
+        AU.add_require<RegPressure>();
+        AU.add_preserve<Dominator>();
     }
     bool run(PassManager *mgr) final;
 
@@ -22,16 +28,37 @@ class LoopInvariant final : public TransformPass {
     using LoopInfo = LoopFind::ResultType::LoopInfo;
     using FuncLoopInfo = LoopFind::ResultType::FuncLoopInfo;
 
+    static constexpr auto PASS_NAME = "licm";
+
     const Dominator::ResultType *_dom{nullptr};
+    const AliasAnalysis::ResultType *_alias{nullptr};
+    const RegPressure::ResultType *_pressure{nullptr};
+    // the values hoisted into the preheaders around each loop, which are
+    // live through it
+    std::unordered_map<ir::BasicBlock *, Pressure> _extra;
 
     void handle_func(ir::Function *func, const FuncLoopInfo &func_loop);
     bool is_invariant_operand(ir::Value *op, const LoopInfo &loop);
     bool is_side_effect_inst(ir::Instruction *inst);
-    bool is_dom_store(ir::Instruction *inst, const LoopInfo &loop);
+    // cheap insts are kept in the loop if hoisting them exceeds the
+    // register budget, as a spill costs more than the inst
+    bool is_cheap(ir::Instruction *inst);
+    Pressure hoist_cost(ir::Instruction *inst, const LoopInfo &loop);
     std::vector<ir::Instruction *> collect_invariant_inst(ir::BasicBlock *bb,
                                                           const LoopInfo &loop);
-    std::vector<ir::Instruction *> collect_gep_store(ir::BasicBlock *bb,
-                                                     const LoopInfo &loop);
+
+    // stores and calls in the loop
+    std::vector<ir::Instruction *> collect_writers(const LoopInfo &loop);
+    bool is_clobbered(const MemLoc &loc,
+                      const std::vector<ir::Instruction *> &writers);
+    bool is_guaranteed_to_execute(ir::BasicBlock *bb, const LoopInfo &loop);
+    bool is_invariant_addr(ir::Value *ptr, const LoopInfo &loop,
+                           std::vector<ir::Instruction *> &geps);
+    std::vector<ir::Instruction *>
+    collect_invariant_load(ir::BasicBlock *bb, const LoopInfo &loop,
+                           const std::vector<ir::Instruction *> &writers);
+    // explain why the remaining invariant candidates are not hoisted
+    void report_missed(const LoopInfo &loop);
 };
 
 }; // namespace pass
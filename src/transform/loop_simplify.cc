@@ -20,7 +20,8 @@ auto LoopSimplify::split_phi_op(PhiInst *phi, const LoopInfo &loop)
 }
 
 BasicBlock *LoopSimplify::create_preheader(BasicBlock *header,
-                                           const LoopInfo &loop) {
+                                           const LoopInfo &loop,
+                                           DomTree *dom) {
     // assume all prebbs of loop body are within the loop itself
     // so here we only process prebb of header bb
     auto func = header->get_func();
@@ -63,26 +64,42 @@ BasicBlock *LoopSimplify::create_preheader(BasicBlock *header,
 
     // connect preheader to other bbs
 
+    using Update = DomTree::Update;
+    vector<Update> updates;
+
     // to avoid iterator invalidation
     auto in_bbs = header->pre_bbs();
     for (auto in_bb : in_bbs) {
         if (not contains(loop.latches, in_bb)) {
             // connect in_bb to preheader
             in_bb->br_inst().replace_operand(header, preheader);
+            updates.push_back({Update::Delete, in_bb, header});
+            updates.push_back({Update::Insert, in_bb, preheader});
         }
     }
 
     // connect preheader to header
     preheader->create_inst<BrInst>(header);
+    updates.push_back({Update::Insert, preheader, header});
+
+    if (dom)
+        dom->apply_updates(updates);
 
     return preheader;
 }
 
-void LoopSimplify::create_exit(BasicBlock *exiting, BasicBlock *exit_target) {
+void LoopSimplify::create_exit(BasicBlock *exiting, BasicBlock *exit_target,
+                               DomTree *dom) {
     auto func = exiting->get_func();
     auto exit = func->create_bb();
     exiting->br_inst().replace_operand(exit_target, exit);
     exit->create_inst<BrInst>(exit_target);
+    if (dom) {
+        using Update = DomTree::Update;
+        dom->apply_updates({{Update::Delete, exiting, exit_target},
+                            {Update::Insert, exiting, exit},
+                            {Update::Insert, exit, exit_target}});
+    }
 
     // phi
     for (auto &&inst : exit_target->insts()) {
@@ -98,11 +115,12 @@ void LoopSimplify::create_exit(BasicBlock *exiting, BasicBlock *exit_target) {
     }
 }
 
-void LoopSimplify::handle_func(Function *func, const FuncLoopInfo &func_loop) {
-    for (auto &&header : func_loop.get_topo_order()) {
+void LoopSimplify::handle_func(Function *func, const FuncLoopInfo &func_loop,
+                               DomTree *dom) {
+    for (auto &&header : func_loop.preorder) {
         auto &&loop = func_loop.loops.at(header);
         if (loop.preheader == nullptr) {
-            create_preheader(header, loop);
+            create_preheader(header, loop, dom);
         }
         for (auto [exiting, exit] : loop.exits) {
             if (exit == nullptr) {
@@ -113,7 +131,7 @@ void LoopSimplify::handle_func(Function *func, const FuncLoopInfo &func_loop) {
                                 return not contains(bbs_in_loop, bb);
                             });
                 assert(exit_target != exiting->suc_bbs().end());
-                create_exit(exiting, *exit_target);
+                create_exit(exiting, *exit_target, dom);
             }
         }
     }
@@ -121,12 +139,14 @@ void LoopSimplify::handle_func(Function *func, const FuncLoopInfo &func_loop) {
 
 bool LoopSimplify::run(pass::PassManager *mgr) {
     auto &&loop_info = mgr->get_result<LoopFind>().loop_info;
+    auto dom = mgr->get_result_if_valid<Dominator>();
     auto m = mgr->get_module();
     for (auto &&func : m->functions()) {
         if (func.is_external) {
             continue;
         }
-        handle_func(&func, loop_info.at(&func));
+        handle_func(&func, loop_info.at(&func),
+                    dom ? &dom->at(&func) : nullptr);
     }
     return false;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "dominator.hh"
 #include "loop_find.hh"
 #include "pass.hh"
 
@@ -11,6 +12,7 @@ class LoopSimplify final : public TransformPass {
         using KillType = AnalysisUsage::KillType;
         AU.set_kill_type(KillType::All);
         AU.add_require<LoopFind>();
+        AU.add_preserve<Dominator>();
     }
     bool run(PassManager *mgr) final;
 
@@ -23,13 +25,15 @@ class LoopSimplify final : public TransformPass {
     static std::pair<std::vector<Pair>, std::vector<Pair>>
     split_phi_op(ir::PhiInst *phi, const LoopInfo &loop);
 
-    static void handle_func(ir::Function *func, const FuncLoopInfo &func_loop);
+    // dom is nullptr if Dominator is not valid
+    static void handle_func(ir::Function *func, const FuncLoopInfo &func_loop,
+                            DomTree *dom);
 
     static ir::BasicBlock *create_preheader(ir::BasicBlock *header,
-                                            const LoopInfo &loop);
+                                            const LoopInfo &loop, DomTree *dom);
 
     static void create_exit(ir::BasicBlock *exiting,
-                            ir::BasicBlock *exit_target);
+                            ir::BasicBlock *exit_target, DomTree *dom);
 };
 
 }; // namespace pass
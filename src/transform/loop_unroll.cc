@@ -1,5 +1,6 @@
 #include "loop_unroll.hh"
 #include "log.hh"
+#include "remark.hh"
 #include <codecvt>
 #include <type_traits>
 
@@ -8,9 +9,15 @@ using namespace ir;
 using namespace std;
 
 optional<LoopUnroll::SimpleLoopInfo>
-LoopUnroll::parse_simple_loop(BasicBlock *header, const LoopInfo &loop) {
+LoopUnroll::parse_simple_loop(BasicBlock *header, const LoopInfo &loop,
+                              const ScalarEvolution::ResultType &scev) {
     SimpleLoopInfo ret;
 
+    auto missed = [&](const string &name, const string &msg) {
+        RemarkEmitter::get().missed(PASS_NAME, name, header, msg);
+        return nullopt;
+    };
+
     // parse header
     ret.header = header;
     ret.bbs = loop.bbs;
@@ -23,22 +30,28 @@ LoopUnroll::parse_simple_loop(BasicBlock *header, const LoopInfo &loop) {
     }
 
     if (loop.sub_loops.size() > 0) {
-        return nullopt;
+        return missed("NotInnermost", "loop contains sub loops");
     }
 
     if (loop.latches.size() > 1) {
-        return nullopt;
+        return missed("MultipleLatches", "loop has " +
+                                             to_string(loop.latches.size()) +
+                                             " latches");
     }
 
     // the loop has too many exiting edges
     if (loop.exits.size() > 1) {
-        return nullopt;
+        return missed("MultipleExits", "loop has " +
+                                           to_string(loop.exits.size()) +
+                                           " exiting blocks");
     }
 
     // the exiting bb is not header
     auto [exiting, exit] = *loop.exits.begin();
     if (exiting != header) {
-        return nullopt;
+        return missed("ExitingNotHeader", "loop exits from " +
+                                              exiting->get_name() +
+                                              " instead of the header");
     }
 
     // parse exit
@@ -47,111 +60,44 @@ LoopUnroll::parse_simple_loop(BasicBlock *header, const LoopInfo &loop) {
     // parse preheader
     ret.preheader = loop.preheader;
 
-    // induction var
-    auto br_inst = ret.header->insts().back().as<BrInst>();
-    assert(br_inst->operands().size() == 3);
-    auto cond = br_inst->get_operand(0);
-    // the induction variable should be of int type
-    if (not cond->is<ICmpInst>()) {
-        return nullopt;
-    }
-
-    auto icmp_inst = cond->as<ICmpInst>();
-    auto icmp_op = icmp_inst->get_icmp_op();
-    auto lhs = icmp_inst->lhs();
-    auto rhs = icmp_inst->rhs();
-
-    auto exit_cond = [&](bool is_ind_rhs) {
-        auto opposite = ICmpInst::opposite_icmp_op(icmp_op);
-        auto op = is_ind_rhs ? opposite : icmp_op;
-        if (br_inst->get_operand(1) == ret.exit) {
-            // exit if cond is true
-            return op;
-        } else if (br_inst->get_operand(2) == ret.exit) {
-            // exit if cond is false
-            return ICmpInst::not_icmp_op(op);
-        } else {
-            throw unreachable_error{};
-        }
-    };
-
-    // at least one op should be mutable after constant folding
-    assert(not lhs->is<ConstInt>() or not rhs->is<ConstInt>());
-    if (lhs->is<ConstInt>()) {
-        ret.ind_var = rhs;
-        ret.icmp_op = exit_cond(true);
-        ret.bound = lhs->as<ConstInt>();
-    } else if (rhs->is<ConstInt>()) {
-        ret.ind_var = lhs;
-        ret.icmp_op = exit_cond(false);
-        ret.bound = rhs->as<ConstInt>();
-    } else {
-        return nullopt;
-    }
-
-    // find initial and step
-    for (auto &&inst : header->insts()) {
-        if (not inst.is<PhiInst>()) {
-            break;
-        }
-        if (&inst != ret.ind_var) {
-            continue;
-        }
-        // the phi for induction variable
-        auto phi_inst = inst.as<PhiInst>();
-        // the phi should has two source, one from preheader and the other from
-        // loop body
-        assert(phi_inst->to_pairs().size() == 2);
-        for (auto [value, source] : phi_inst->to_pairs()) {
-            if (contains(loop.bbs, source)) {
-                // step
-                if (not value->is<IBinaryInst>()) {
-                    continue;
-                }
-                auto ibinary_inst = value->as<IBinaryInst>();
-                auto ibin_op = ibinary_inst->get_ibin_op();
-                if (ibin_op != IBinaryInst::ADD) {
-                    continue;
-                }
-                if (ibinary_inst->lhs()->is<ConstInt>() and
-                    ibinary_inst->rhs() == ret.ind_var) {
-                    ret.step = ibinary_inst->lhs()->as<ConstInt>();
-                } else if (ibinary_inst->rhs()->is<ConstInt>() and
-                           ibinary_inst->lhs() == ret.ind_var) {
-                    ret.step = ibinary_inst->rhs()->as<ConstInt>();
-                }
-            } else {
-                // initial
-                if (not value->is<ConstInt>()) {
-                    continue;
-                }
-                ret.initial = value->as<ConstInt>();
-            }
-        }
+    auto trip_count = scev.trip_count(header);
+    if (not trip_count.has_value()) {
+        return missed("UnknownTripCount", "cannot compute the trip count");
     }
-    if (ret.initial == nullptr or ret.step == nullptr) {
-        return nullopt;
+    if (not trip_count->is_const()) {
+        return missed("NonConstTripCount", "trip count is not a constant");
     }
+    ret.trip_count = trip_count->const_val();
 
     return ret;
 }
 
-bool LoopUnroll::should_unroll(const SimpleLoopInfo &simple_loop) {
-    int initial = simple_loop.initial->val();
-    int step = simple_loop.step->val();
-    int bound = simple_loop.bound->val();
-
+bool LoopUnroll::should_unroll(const SimpleLoopInfo &simple_loop,
+                               const Pressure &pressure) {
     long long inst_cnt{0};
     for (auto bb : simple_loop.bbs) {
         inst_cnt += bb->insts().size();
     }
 
-    int estimate = (bound - initial) / step;
-
-    return inst_cnt * estimate < UNROLL_MAX;
+    long long estimate = simple_loop.trip_count;
+    auto limit = pressure.fits() ? UNROLL_MAX : UNROLL_MAX_SPILLING;
+
+    if (inst_cnt * estimate >= limit) {
+        RemarkEmitter::get().missed(
+            PASS_NAME, pressure.fits() ? "TooLarge" : "RegisterPressure",
+            simple_loop.header,
+            "unrolled size " + to_string(inst_cnt) + " insts * " +
+                to_string(estimate) + " iterations exceeds limit " +
+                to_string(limit) +
+                (pressure.fits() ? "" : " of the loops over the register "
+                                        "budget"));
+        return false;
+    }
+    return true;
 }
 
-void LoopUnroll::unroll_simple_loop(const SimpleLoopInfo &simple_loop) {
+void LoopUnroll::unroll_simple_loop(const SimpleLoopInfo &simple_loop,
+                                    DomTree *dom) {
     auto header = simple_loop.header;
 
     // topological sort
@@ -202,29 +148,18 @@ void LoopUnroll::unroll_simple_loop(const SimpleLoopInfo &simple_loop) {
         }
         for (auto [value, source] : phi_inst->to_pairs()) {
             if (not contains(simple_loop.bbs, source)) {
-                old2new.emplace(phi_dst2src[phi_inst], value);
+                old2new.emplace(phi_inst, value);
             }
         }
     }
-
-    auto should_exit = [&](int i) {
-        int bound = simple_loop.bound->val();
-        switch (simple_loop.icmp_op) {
-        case ICmpInst::EQ:
-            return i == bound;
-        case ICmpInst::NE:
-            return i != bound;
-        case ICmpInst::LT:
-            return i < bound;
-        case ICmpInst::LE:
-            return i <= bound;
-        case ICmpInst::GT:
-            return i > bound;
-        case ICmpInst::GE:
-            return i >= bound;
-        default:
-            throw unreachable_error{};
-        }
+    // the phis take the values from the last iteration at the same time, the
+    // value from the latch may be a constant or another phi
+    auto next_phis = [&]() {
+        map<Value *, Value *> next;
+        for (auto [phi, src] : phi_dst2src)
+            next[phi] = contains(old2new, src) ? old2new.at(src) : src;
+        for (auto [phi, value] : next)
+            old2new[phi] = value;
     };
 
     auto func = header->get_func();
@@ -241,7 +176,6 @@ void LoopUnroll::unroll_simple_loop(const SimpleLoopInfo &simple_loop) {
         for (auto &inst : old_bb->insts()) {
             if (old_bb == header) {
                 if (inst.is<PhiInst>()) {
-                    old2new[&inst] = old2new[phi_dst2src[&inst]];
                     continue;
                 } else if (inst.is<BrInst>()) {
                     continue;
@@ -273,8 +207,7 @@ void LoopUnroll::unroll_simple_loop(const SimpleLoopInfo &simple_loop) {
     clone2bb(header);
     auto bbs_entry = unroll_entry();
 
-    for (int i = simple_loop.initial->val(); not should_exit(i);
-         i += simple_loop.step->val()) {
+    for (int i = 0; i < simple_loop.trip_count; ++i) {
         // connect last exit to current entry
         auto last_exit = unroll_exit();
         clone_bbs();
@@ -285,6 +218,7 @@ void LoopUnroll::unroll_simple_loop(const SimpleLoopInfo &simple_loop) {
         for (auto bb : bodies_order) {
             clone2bb(bb);
         }
+        next_phis();
         clone2bb(header);
     }
 
@@ -302,6 +236,15 @@ void LoopUnroll::unroll_simple_loop(const SimpleLoopInfo &simple_loop) {
     // connect preheader
     simple_loop.preheader->br_inst().replace_operand(header, bbs_entry);
 
+    // the old loop is unreachable now, but still alive
+    if (dom) {
+        using Update = DomTree::Update;
+        dom->apply_updates({{Update::Delete, simple_loop.preheader, header},
+                            {Update::Delete, header, simple_loop.exit},
+                            {Update::Insert, simple_loop.preheader, bbs_entry},
+                            {Update::Insert, unroll_exit(), simple_loop.exit}});
+    }
+
     // remove old bbs
     for (auto it = func->bbs().begin(); it != func->bbs().end();) {
         if (contains(simple_loop.bbs, &*it)) {
@@ -312,30 +255,41 @@ void LoopUnroll::unroll_simple_loop(const SimpleLoopInfo &simple_loop) {
     }
 }
 
-void LoopUnroll::handle_func(Function *func, const FuncLoopInfo &func_loop) {
-    for (auto &&header : func_loop.get_topo_order()) {
+void LoopUnroll::handle_func(Function *func, const FuncLoopInfo &func_loop,
+                             const ScalarEvolution::ResultType &scev,
+                             const RegPressure::ResultType &pressure,
+                             DomTree *dom) {
+    for (auto &&header : func_loop.preorder) {
         auto &&loop = func_loop.loops.at(header);
         assert(loop.preheader != nullptr);
-        auto simple_loop = parse_simple_loop(header, loop);
+        auto simple_loop = parse_simple_loop(header, loop, scev);
         if (not simple_loop.has_value()) {
             continue;
         }
-        if (not should_unroll(simple_loop.value())) {
+        if (not should_unroll(simple_loop.value(), pressure.loop(header))) {
             continue;
         }
         debugs << "unrolling " + simple_loop->header->get_name() << '\n';
-        unroll_simple_loop(simple_loop.value());
+        RemarkEmitter::get().applied(PASS_NAME, "FullyUnrolled", header,
+                                     "completely unrolled loop");
+        unroll_simple_loop(simple_loop.value(), dom);
+        // the insts of the old loop are erased
+        scev.forget();
     }
 }
 
 bool LoopUnroll::run(PassManager *mgr) {
     auto &&loop_info = mgr->get_result<LoopFind>().loop_info;
+    auto &&scev = mgr->get_result<ScalarEvolution>();
+    auto &&pressure = mgr->get_result<RegPressure>();
+    auto dom = mgr->get_result_if_valid<Dominator>();
     auto m = mgr->get_module();
     for (auto &&func : m->functions()) {
         if (func.is_external) {
             continue;
         }
-        handle_func(&func, loop_info.at(&func));
+        handle_func(&func, loop_info.at(&func), scev, pressure,
+                    dom ? &dom->at(&func) : nullptr);
     }
     return false;
 }
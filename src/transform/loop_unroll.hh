@@ -2,10 +2,13 @@
 
 #include "control_flow.hh"
 #include "dead_code.hh"
+#include "dominator.hh"
 #include "loop_find.hh"
 #include "loop_invariant.hh"
 #include "loop_simplify.hh"
 #include "pass.hh"
+#include "reg_pressure.hh"
+#include "scalar_evolution.hh"
 
 namespace pass {
 
@@ -18,12 +21,18 @@ class LoopUnroll final : public TransformPass {
         AU.add_require<ControlFlow>();
         AU.add_require<LoopSimplify>();
         AU.add_require<LoopFind>();
+        AU.add_require<ScalarEvolution>();
+        AU.add_require<RegPressure>();
+        AU.add_preserve<Dominator>();
         AU.add_post<DeadCode>();
     }
     bool run(PassManager *mgr) final;
 
   private:
     static constexpr int UNROLL_MAX = 10000;
+    // each copy of a body over the register budget carries its spill code
+    static constexpr int UNROLL_MAX_SPILLING = 1000;
+    static constexpr auto PASS_NAME = "loop-unroll";
 
     using LoopInfo = LoopFind::ResultType::LoopInfo;
     using FuncLoopInfo = LoopFind::ResultType::FuncLoopInfo;
@@ -32,19 +41,24 @@ class LoopUnroll final : public TransformPass {
     struct SimpleLoopInfo {
         std::set<ir::BasicBlock *> bbs, bodies;
         ir::BasicBlock *header{nullptr}, *exit{nullptr}, *preheader{nullptr};
-        ir::Value *ind_var{nullptr};
-        ir::ConstInt *initial{nullptr}, *bound{nullptr}, *step{nullptr};
-        ir::ICmpInst::ICmpOp icmp_op;
+        int trip_count{0};
     };
 
     static std::optional<SimpleLoopInfo>
-    parse_simple_loop(ir::BasicBlock *header, const LoopInfo &loop);
+    parse_simple_loop(ir::BasicBlock *header, const LoopInfo &loop,
+                      const ScalarEvolution::ResultType &scev);
 
-    static bool should_unroll(const SimpleLoopInfo &simple_loop);
+    static bool should_unroll(const SimpleLoopInfo &simple_loop,
+                              const Pressure &pressure);
 
-    static void unroll_simple_loop(const SimpleLoopInfo &simple_loop);
+    // dom is nullptr if Dominator is not valid
+    static void unroll_simple_loop(const SimpleLoopInfo &simple_loop,
+                                   DomTree *dom);
 
-    static void handle_func(ir::Function *func, const FuncLoopInfo &func_loop);
+    static void handle_func(ir::Function *func, const FuncLoopInfo &func_loop,
+                            const ScalarEvolution::ResultType &scev,
+                            const RegPressure::ResultType &pressure,
+                            DomTree *dom);
 };
 
 }; // namespace pass
@@ -31,7 +31,6 @@ bool pointer_is_basic_alloc(Value *v) {
 }
 
 void Mem2reg::clear() {
-    _phi_table.clear();
     _phi_lval.clear();
     _var_new_name.clear();
 }
@@ -71,19 +70,11 @@ void Mem2reg::generate_phi(Function *f) {
         }
     }
     // record which block needs a phi inst for var
+    auto &&dom_tree = _dominator->at(f);
     for (auto var : globals) {
-        vector<BasicBlock *> work_list(blocks[var].begin(), blocks[var].end());
-        for (unsigned i = 0; i < work_list.size(); ++i) {
-            auto bb = work_list[i];
-            for (auto df_bb : _dominator->dom_frontier.at(bb)) {
-                if (_phi_table.find({var, df_bb}) == _phi_table.end()) {
-                    auto phi = df_bb->insert_inst<PhiInst>(
-                        df_bb->insts().begin(), var);
-                    work_list.push_back(df_bb);
-                    _phi_lval[phi] = var;
-                    _phi_table.insert({var, df_bb});
-                }
-            }
+        for (auto df_bb : dom_tree.iterated_frontier(blocks[var])) {
+            auto phi = df_bb->insert_inst<PhiInst>(df_bb->insts().begin(), var);
+            _phi_lval[phi] = var;
         }
     }
 }
@@ -141,7 +132,7 @@ void Mem2reg::re_name(BasicBlock *bb) {
         }
     }
     // re_name all the dom_succ_bb of current bb
-    for (auto dom_succ_bb : _dominator->dom_tree_succ_blocks.at(bb)) {
+    for (auto dom_succ_bb : _dominator->dom_tree_succ_blocks(bb)) {
         re_name(dom_succ_bb);
     }
 
@@ -19,6 +19,7 @@ class Mem2reg final : public pass::TransformPass {
         using KillType = pass::AnalysisUsage::KillType;
         AU.set_kill_type(KillType::All);
         AU.add_require<pass::Dominator>();
+        AU.add_preserve<pass::Dominator>();
         AU.add_post<DeadCode>();
     }
     virtual bool run(pass::PassManager *mgr) override;
@@ -31,7 +32,6 @@ class Mem2reg final : public pass::TransformPass {
     bool is_wanted_phi(ir::Value *);
     void clear();
 
-    std::set<std::pair<ir::Value *, ir::BasicBlock *>> _phi_table;
     std::map<ir::PhiInst *, ir::Value *> _phi_lval;
     std::map<ir::Value *, std::vector<ir::Value *>> _var_new_name;
 };
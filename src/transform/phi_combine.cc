@@ -8,6 +8,7 @@ using namespace ir;
 
 bool PhiCombine::run(PassManager *mgr) {
     auto m = mgr->get_module();
+    _dom = mgr->get_result_if_valid<Dominator>();
     for (auto &&func : m->functions()) {
         if (func.is_external) {
             continue;
@@ -92,13 +93,23 @@ bool PhiCombine::try_combine(BasicBlock *bb, BasicBlock *pre_bb) {
     }
 
     // reconnect cfg
+    using Update = DomTree::Update;
+    vector<Update> updates;
     // in case iterator invalidation
     auto pre_pre_bbs = pre_bb->pre_bbs();
     for (auto pre_pre : pre_pre_bbs) {
         pre_pre->br_inst().replace_operand(pre_bb, bb);
+        updates.push_back({Update::Delete, pre_pre, pre_bb});
+        updates.push_back({Update::Insert, pre_pre, bb});
     }
-    // erase pre_bb
+    auto pre_sucs = pre_bb->suc_bbs();
     pre_bb->erase_inst(&pre_bb->br_inst());
+    for (auto suc : pre_sucs) {
+        updates.push_back({Update::Delete, pre_bb, suc});
+    }
+    if (_dom)
+        _dom->at(pre_bb->get_func()).apply_updates(updates);
+    // erase pre_bb
     pre_bb->get_func()->erase_bb(pre_bb);
 
     return true;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "dominator.hh"
 #include "pass.hh"
 
 namespace pass {
@@ -9,12 +10,15 @@ class PhiCombine final : public TransformPass {
     void get_analysis_usage(AnalysisUsage &AU) const final {
         using KillType = AnalysisUsage::KillType;
         AU.set_kill_type(KillType::All);
+        AU.add_preserve<Dominator>();
     }
     bool run(PassManager *mgr) final;
 
   private:
     void handle_func(ir::Function *func);
     bool try_combine(ir::BasicBlock *bb, ir::BasicBlock *pre_bb);
+
+    Dominator::ResultType *_dom;
 };
 
 }; // namespace pass
\ No newline at end of file
@@ -15,6 +15,8 @@ using namespace std;
 
 bool RmUnreachBB::run(PassManager *mgr) {
     auto m = mgr->get_module();
+    // unreachable bbs are not in the dominator tree, nothing to update
+    [[maybe_unused]] auto dom = mgr->get_result_if_valid<Dominator>();
     bool changed = false;
     for (auto &f_r : m->functions()) {
         if (f_r.is_external)
@@ -64,6 +66,7 @@ bool RmUnreachBB::run(PassManager *mgr) {
                             }
                         }
                         // maybe rm_bb has been delete
+                        assert(not dom or not dom->at(&f_r).contains(rm_bb));
                         remove_bb(rm_bb);
                         changed = true;
                     }
@@ -83,6 +86,7 @@ bool RmUnreachBB::run(PassManager *mgr) {
         while (not unreach_bbs.empty()) {
             auto rm_bb = unreach_bbs.front();
             unreach_bbs.pop_front();
+            assert(not dom or not dom->at(&f_r).contains(rm_bb));
             remove_bb(rm_bb);
             changed = true;
         }
@@ -1,6 +1,7 @@
 #pragma once
 #include "basic_block.hh"
 #include "dead_code.hh"
+#include "dominator.hh"
 #include "pass.hh"
 #include <iostream>
 
@@ -12,11 +13,12 @@ class RmUnreachBB final : public pass::TransformPass {
     virtual void get_analysis_usage(pass::AnalysisUsage &AU) const override {
         using KillType = pass::AnalysisUsage::KillType;
         AU.set_kill_type(KillType::All);
+        AU.add_preserve<Dominator>();
         AU.add_post<DeadCode>();
     }
     virtual bool run(pass::PassManager *mgr) override;
 
-    void remove_bb(ir::BasicBlock *);
+    static void remove_bb(ir::BasicBlock *);
 
   private:
 };
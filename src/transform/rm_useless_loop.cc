@@ -17,32 +17,35 @@ bool RmUselessLoop::run(pass::PassManager *mgr) {
     auto m = mgr->get_module();
     func_loop = &mgr->get_result<LoopFind>();
     func_info = &mgr->get_result<FuncInfo>();
+    scev = &mgr->get_result<ScalarEvolution>();
     bool changed = false;
     for (auto &f_r : m->functions()) {
         if (f_r.is_external)
             continue;
         auto &info = func_loop->loop_info.at(&f_r);
-        auto tmp = info.get_topo_order();
-        vector<BasicBlock *> reverse_order{tmp.rbegin(), tmp.rend()};
         list<BasicBlock *> rm_loops{};
-        map<BasicBlock *, bool> bb_critical{};
-        bool critical = false;
-        for (auto loop_head : reverse_order) {
-            // consider loop with break as critical
-            if (info.loops.at(loop_head).exits.size() > 1)
+        for (auto loop_head : info.postorder) {
+            // consider loop with break as critical, the preheader is linked to
+            // the exit directly, so the loop should exit from the header to a
+            // bb without other pre_bbs
+            auto &exits = info.loops.at(loop_head).exits;
+            if (exits.size() > 1 or not contains(exits, loop_head) or
+                exits.at(loop_head) == nullptr)
                 continue;
+            bool critical = false;
             for (auto loop_body : info.loops.at(loop_head).bbs) {
                 if (loop_body == loop_head) {
-                    // check if insts in loop_head aren't used out of loop
+                    // check if insts in loop_head aren't used out of loop, or
+                    // can be replaced by their values at exit
                     for (auto &inst : loop_head->insts()) {
                         if (is_a<BrInst>(&inst))
                             continue;
                         for (auto &use : inst.get_use_list()) {
-                            critical |= out_of_loop(
-                                as_a<Instruction>(use.user)->get_parent(),
-                                loop_head);
-                            if (critical)
-                                cout << endl;
+                            critical |=
+                                out_of_loop(
+                                    as_a<Instruction>(use.user)->get_parent(),
+                                    loop_head) and
+                                not scev->has_exit_value(&inst, loop_head);
                         }
                     }
                 } else {
@@ -56,8 +59,10 @@ bool RmUselessLoop::run(pass::PassManager *mgr) {
         while (not rm_loops.empty()) {
             auto top = rm_loops.front();
             rm_loops.pop_front();
-            remove_loop(top);
-            changed = true;
+            // the uses replaced by the loops removed before are not in the
+            // cached recurrences
+            scev->forget();
+            changed |= remove_loop(top);
         }
     }
     return changed;
@@ -68,7 +73,7 @@ bool RmUselessLoop::is_critical(ir::BasicBlock *bb) {
         auto inst = &inst_r;
         if (is_a<StoreInst>(inst))
             return true;
-        if (is_a<CallInst>(inst) && not func_info->is_pure_function(
+        if (is_a<CallInst>(inst) && func_info->has_side_effect(
                                         as_a<Function>(inst->operands()[0])))
             return true;
     }
@@ -77,14 +82,35 @@ bool RmUselessLoop::is_critical(ir::BasicBlock *bb) {
 
 bool RmUselessLoop::out_of_loop(ir::BasicBlock *user,
                                 ir::BasicBlock *loop_head) {
-    return not contains(
-        func_loop->loop_info.at(loop_head->get_func()).loops.at(loop_head).bbs,
-        user);
+    return not func_loop->loop_info.at(loop_head->get_func())
+                   .in_loop(user, loop_head);
 }
 
-void RmUselessLoop::remove_loop(ir::BasicBlock *head) {
+bool RmUselessLoop::remove_loop(ir::BasicBlock *head) {
     auto &info = func_loop->loop_info.at(head->get_func()).loops.at(head);
     auto pre_br = &info.preheader->br_inst();
+    // replace the uses out of the loop with the value at exit
+    vector<pair<Instruction *, vector<pair<User *, unsigned>>>> outer_uses;
+    for (auto &inst : head->insts()) {
+        vector<pair<User *, unsigned>> uses;
+        for (auto &use : inst.get_use_list()) {
+            if (out_of_loop(as_a<Instruction>(use.user)->get_parent(), head))
+                uses.push_back({use.user, use.op_idx});
+        }
+        if (uses.empty())
+            continue;
+        // the init value may be no longer linear after the loops before
+        if (not scev->has_exit_value(&inst, head))
+            return false;
+        outer_uses.push_back({&inst, std::move(uses)});
+    }
+    for (auto &[inst, uses] : outer_uses) {
+        auto exit_value = scev->expand_exit_value(inst, head, pre_br);
+        assert(exit_value);
+        for (auto [user, op_idx] : uses) {
+            user->set_operand(op_idx, exit_value);
+        }
+    }
     unsigned i;
     for (i = 0; i < pre_br->operands().size(); i++) {
         if (pre_br->get_operand(i) == head) {
@@ -110,4 +136,5 @@ void RmUselessLoop::remove_loop(ir::BasicBlock *head) {
             break;
     }
     // FIXME:suc/pre bbs error
+    return true;
 }
\ No newline at end of file
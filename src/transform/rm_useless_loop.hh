@@ -6,11 +6,13 @@
 #include "loop_find.hh"
 #include "loop_simplify.hh"
 #include "pass.hh"
+#include "scalar_evolution.hh"
 
 namespace pass {
 
 // when a loop body doesn't contain critical inst and the insts of the loop head
-// just are used in the loop, the loop is useless
+// just are used in the loop (or their values at exit are known), the loop is
+// useless
 class RmUselessLoop final : public pass::TransformPass {
 
   public:
@@ -19,6 +21,7 @@ class RmUselessLoop final : public pass::TransformPass {
         using KillType = pass::AnalysisUsage::KillType;
         AU.add_require<LoopSimplify>();
         AU.add_require<LoopFind>();
+        AU.add_require<ScalarEvolution>();
         AU.add_require<FuncInfo>();
         AU.set_kill_type(KillType::All);
         AU.add_post<pass::DeadCode>();
@@ -30,11 +33,13 @@ class RmUselessLoop final : public pass::TransformPass {
 
     bool out_of_loop(ir::BasicBlock *user, ir::BasicBlock *loop_head);
 
-    void remove_loop(ir::BasicBlock *);
+    // false if the values at exit are unknown
+    bool remove_loop(ir::BasicBlock *);
 
   private:
     const LoopFind::ResultType *func_loop;
     const FuncInfo::ResultType *func_info;
+    const ScalarEvolution::ResultType *scev;
 };
 
 } // namespace pass
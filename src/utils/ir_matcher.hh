@@ -128,5 +128,8 @@ inline Ptr<IBinaryMatcher> imul(Ptr<Matcher> lm, Ptr<Matcher> rm) {
 inline Ptr<IBinaryMatcher> idiv(Ptr<Matcher> lm, Ptr<Matcher> rm) {
     return std::make_shared<IBinaryMatcher>(IBinaryInst::SDIV, lm, rm, false);
 }
+inline Ptr<IBinaryMatcher> irem(Ptr<Matcher> lm, Ptr<Matcher> rm) {
+    return std::make_shared<IBinaryMatcher>(IBinaryInst::SREM, lm, rm, false);
+}
 
 }; // namespace Matcher
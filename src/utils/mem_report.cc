@@ -0,0 +1,62 @@
+#include "mem_report.hh"
+
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sys/resource.h>
+
+using namespace std;
+
+// read `field` (in kB) from /proc/self/status, return 0 if unavailable
+static size_t read_proc_status(const string &field) {
+    ifstream status{"/proc/self/status"};
+    string key;
+    while (status >> key) {
+        if (key == field + ":") {
+            size_t kb;
+            status >> kb;
+            return kb;
+        }
+        status.ignore(numeric_limits<streamsize>::max(), '\n');
+    }
+    return 0;
+}
+
+void MemReport::checkpoint(string &&phase) {
+    if (not _enabled)
+        return;
+
+    auto peak = read_proc_status("VmHWM");
+    if (peak == 0) {
+        // no procfs, fall back to the peak of the whole process
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        peak = usage.ru_maxrss;
+    }
+    auto rss = read_proc_status("VmRSS");
+
+    vector<size_t> live;
+    for (auto &[name, counter] : _counters)
+        live.push_back(counter());
+    _records.push_back({std::move(phase), peak, rss, std::move(live)});
+
+    // reset VmHWM so that the next checkpoint reports the peak of its own phase
+    ofstream{"/proc/self/clear_refs"} << "5";
+}
+
+void MemReport::print(ostream &os) const {
+    os << "=========Memory Report=========\n";
+    os << left << setw(10) << "phase" << right << setw(12) << "peak(kB)"
+       << setw(12) << "rss(kB)";
+    for (auto &[name, counter] : _counters)
+        os << setw(max<size_t>(name.size() + 2, 12)) << name;
+    os << "\n";
+    for (auto &record : _records) {
+        os << left << setw(10) << record.phase << right << setw(12)
+           << record.peak_rss_kb << setw(12) << record.rss_kb;
+        for (size_t i = 0; i < _counters.size(); ++i)
+            os << setw(max<size_t>(_counters[i].first.size() + 2, 12))
+               << record.live[i];
+        os << "\n";
+    }
+}
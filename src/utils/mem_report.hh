@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* count live objects of T, T should inherit from LiveCounter<T>
+ *
+ * e.g. class BasicBlock : public Value, public LiveCounter<BasicBlock>
+ */
+template <typename T> class LiveCounter {
+  public:
+    static size_t live() { return _live; }
+
+  protected:
+    LiveCounter() { ++_live; }
+    LiveCounter(const LiveCounter &) { ++_live; }
+    ~LiveCounter() { --_live; }
+
+  private:
+    static inline size_t _live{0};
+};
+
+/* per phase memory report, enabled by `-mem-report`
+ *
+ * each checkpoint records the peak RSS since the previous checkpoint, the
+ * current RSS and the live object count of each registered counter
+ */
+class MemReport {
+  public:
+    static MemReport &get() {
+        static MemReport report;
+        return report;
+    }
+
+    void enable() { _enabled = true; }
+    bool enabled() const { return _enabled; }
+
+    void add_counter(std::string &&name, std::function<size_t()> &&counter) {
+        _counters.push_back({std::move(name), std::move(counter)});
+    }
+
+    // end of a phase, do nothing if not enabled
+    void checkpoint(std::string &&phase);
+
+    void print(std::ostream &os) const;
+
+  private:
+    struct Record {
+        std::string phase;
+        size_t peak_rss_kb;
+        size_t rss_kb;
+        std::vector<size_t> live;
+    };
+
+    bool _enabled{false};
+    std::vector<std::pair<std::string, std::function<size_t()>>> _counters;
+    std::vector<Record> _records;
+
+    MemReport() = default;
+};
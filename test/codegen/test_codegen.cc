@@ -1,11 +1,15 @@
 #include "algebraic_simplify.hh"
+#include "alias_analysis.hh"
 #include "array_visit.hh"
 #include "ast.hh"
+#include "block_frequency.hh"
+#include "call_graph.hh"
 #include "codegen.hh"
 #include "const_propagate.hh"
 #include "continuous_addition.hh"
 #include "control_flow.hh"
 #include "dead_code.hh"
+#include "dependence.hh"
 #include "depth_order.hh"
 #include "dominator.hh"
 #include "err.hh"
@@ -23,11 +27,15 @@
 #include "loop_simplify.hh"
 #include "loop_unroll.hh"
 #include "mem2reg.hh"
+#include "memory_ssa.hh"
 #include "pass.hh"
 #include "phi_combine.hh"
 #include "raw_ast.hh"
+#include "reg_pressure.hh"
 #include "remove_unreach_bb.hh"
+#include "scalar_evolution.hh"
 #include "strength_reduce.hh"
+#include "value_range.hh"
 
 #include <filesystem>
 #include <fstream>
@@ -67,8 +75,16 @@ int main(int argc, char **argv) {
     // analysis
     pm.add_pass<Dominator>();
     pm.add_pass<LoopFind>();
+    pm.add_pass<ScalarEvolution>();
+    pm.add_pass<CallGraph>();
     pm.add_pass<FuncInfo>();
     pm.add_pass<DepthOrder>();
+    pm.add_pass<AliasAnalysis>();
+    pm.add_pass<DependenceAnalysis>();
+    pm.add_pass<ValueRange>();
+    pm.add_pass<BlockFrequency>();
+    pm.add_pass<RegPressure>();
+    pm.add_pass<MemorySSA>();
 
     // transform
     pm.add_pass<RmUnreachBB>();
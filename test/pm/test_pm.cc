@@ -86,6 +86,25 @@ class DeadCodeElim : public TransformPass {
     }
 };
 
+class LoopSimplify : public TransformPass {
+  public:
+    LoopSimplify() = default;
+
+    virtual void get_analysis_usage(AnalysisUsage &AU) const override {
+        using KillType = AnalysisUsage::KillType;
+        AU.set_kill_type(KillType::All);
+        AU.add_preserve<Dominator>();
+    }
+
+    virtual bool run(PassManager *mgr) override {
+        // Dominator is updated in place
+        auto result = mgr->get_result_if_valid<Dominator>();
+        cout << "running LoopSimplify, Dominator is "
+             << (result ? "valid" : "invalid") << endl;
+        return false;
+    }
+};
+
 class Pass1 : public AnalysisPass {
   public:
     struct ResultType {};
@@ -135,6 +154,7 @@ int main() {
     pm.add_pass<DeadCodeElim>();
     pm.add_pass<Dominator>();
     pm.add_pass<Mem2reg>();
+    pm.add_pass<LoopSimplify>();
 
     // we don't want a suggested post pass to run now
     pm.reset();
@@ -145,4 +165,11 @@ int main() {
     pm.reset();
     cout << "===Test3===" << endl;
     pm.run({PassID<Mem2reg>()});
+
+    // Dominator is preserved by LoopSimplify while Pass1 and Pass2 are killed,
+    // so Dominator should not run again for Mem2reg
+    pm.reset();
+    cout << "===Test4===" << endl;
+    pm.run({PassID<Dominator>(), PassID<LoopSimplify>(), PassID<Mem2reg>()},
+           false);
 }